@@ -16,12 +16,14 @@
 #include "helpers.h"
 #include "Network.h"
 #include "ExploringEdgeGenerator.h"
+#include "DistanceMatrix.h"
+#include "BranchAndBound.h"
 
 using namespace std;
 namespace po = boost::program_options;
 
 long calculate_objective(Network& network,
-                         igraph_matrix_t* shortest_paths_matx,
+                         DistanceMatrix<long>& distances,
                          std::vector<long>& facility_indexes,
                          long facility_capacity)
 {
@@ -38,26 +40,25 @@ long calculate_objective(Network& network,
     }
     for (long i = 0; i < network.source_indexes.size(); i++) {
         for (long j = 0; j < facility_indexes.size(); j++) {
+            long dist = distances.to_node(i, facility_indexes[j]);
+            if (dist == DistanceMatrix<long>::unreachable()) continue;
             lemon::ListDigraph::Arc e = g.addArc(nodes[i], nodes[network.source_indexes.size()+j]);
             capacities[e] = 1;
-            weights[e] = MATRIX((*shortest_paths_matx), network.source_indexes[i], facility_indexes[j]);
+            weights[e] = dist;
         }
     }
 
     //add additional source and destination nodes
     lemon::ListDigraph::Node source = g.addNode();
     lemon::ListDigraph::Node target = g.addNode();
-    //if a node has at least one outgoing edge, then this node is a source node
-    for (lemon::ListDigraph::NodeIt nodeit(g); nodeit != lemon::INVALID; ++nodeit) {
-        if ((g.id(nodeit) == g.id(source)) || (g.id(nodeit) == g.id(target))) continue;
-        lemon::ListDigraph::OutArcIt eit(g, nodeit);
-        if (eit != lemon::INVALID) {
-            //this is source node
-            lemon::ListDigraph::Arc e = g.addArc(source, nodeit);
+    //customers go first, then facilities
+    for (long i = 0; i < vcount; i++) {
+        if (i < network.source_indexes.size()) {
+            lemon::ListDigraph::Arc e = g.addArc(source, nodes[i]);
             capacities[e] = 1;
             weights[e] = 0;
         } else {
-            lemon::ListDigraph::Arc e = g.addArc(nodeit, target);
+            lemon::ListDigraph::Arc e = g.addArc(nodes[i], target);
             capacities[e] = facility_capacity;
             weights[e] = 0;
         }
@@ -69,7 +70,7 @@ long calculate_objective(Network& network,
     //        print_graph(&g, &weights, &capacities);
     lemon::CostScaling<lemon::ListDigraph, long, long>::ProblemType pt = cost_scaling_alg.run();
     if (pt != lemon::CostScaling<lemon::ListDigraph, long, long>::ProblemType::OPTIMAL) {
-        throw "Cost Scaling graph is infeasible";
+        return BranchAndBound::infeasible(); //some customers can not reach the facilities, as in other components
     }
 
     return cost_scaling_alg.totalCost();
@@ -83,10 +84,10 @@ bool next_facility_indexes(std::vector<long>& facility_index, long max_index, lo
      */
     long size = facility_index.size();
     facility_index[cur]++;
-    if (facility_index[cur] == max_index) {
+    if (facility_index[cur] > max_index - (size - 1 - cur)) {
         if (cur == 0) return false;
         bool result = next_facility_indexes(facility_index, max_index, cur-1);
-        facility_index[cur] = facility_index[cur-1];
+        facility_index[cur] = facility_index[cur-1] + 1;
         return result;
     }
     return true;
@@ -97,6 +98,8 @@ int main(int argc, const char** argv) {
     string outfilename;
     long facilities_to_locate;
     long facility_capacity;
+    unsigned threads;
+    bool enumerate;
 
     po::options_description desc("Allowed options");
     desc.add_options()
@@ -104,7 +107,9 @@ int main(int argc, const char** argv) {
             ("input,i", po::value<string>(&filename)->required(), "Input file, a network")
             ("ouput,o", po::value<string>(&outfilename)->required(), "Output file, json")
             ("facilities,n", po::value<long>(&facilities_to_locate)->required(), "Facilities to locate")
-            ("faccap,c", po::value<long>(&facility_capacity)->default_value(1), "Capacity of facilities");
+            ("faccap,c", po::value<long>(&facility_capacity)->default_value(1), "Capacity of facilities")
+            ("threads,t", po::value<unsigned>(&threads)->default_value(std::thread::hardware_concurrency()), "Number of threads for the distance matrix and the search")
+            ("enumerate,e", po::value<bool>(&enumerate)->default_value(false), "Evaluate every set of facilities instead of branch and bound");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -116,32 +121,36 @@ int main(int argc, const char** argv) {
 
     Network network(filename);
 
-    // calculate shortest paths
-    igraph_vector_t real_weights;
-    igraph_vector_init(&real_weights, igraph_ecount(&network.graph));
-    for (long i = 0 ; i < network.weights.size(); i++)
-        VECTOR(real_weights)[i] = network.weights[i];
-
+    // calculate shortest paths from customers to all candidate nodes
     auto start = std::chrono::high_resolution_clock::now();
-    igraph_vs_t all_nodes;
-    igraph_vs_all(&all_nodes);
-    igraph_matrix_t res_matx;
-    igraph_matrix_init(&res_matx, 0, 0);
-    igraph_shortest_paths_bellman_ford(&network.graph, &res_matx, all_nodes, all_nodes, &real_weights, IGRAPH_ALL);
-    igraph_vector_destroy(&real_weights);
+    std::vector<long> candidates(network.graph_size());
+    for (long i = 0; i < candidates.size(); i++) {
+        candidates[i] = i;
+    }
+    DistanceMatrix<long> distances(network.csr, network.source_indexes, candidates, threads);
     auto finish = std::chrono::high_resolution_clock::now();
 
-    //for each set of facilities - calculate matching (objective function)
-    long best_objective = LONG_MAX;
-    std::vector<long> facility_index(facilities_to_locate,0);
-    for (long i = 0; i < facilities_to_locate; i++) {
-        facility_index[i] = i;
+    long best_objective = BranchAndBound::infeasible();
+    long evaluated_sets = 0;
+    if (enumerate) {
+        //for each set of facilities - calculate matching (objective function)
+        std::vector<long> facility_index(facilities_to_locate,0);
+        for (long i = 0; i < facilities_to_locate; i++) {
+            facility_index[i] = i;
+        }
+        long max_index = network.graph_size() - 1;
+        do {
+            //infeasible sets are LONG_MAX and never below a feasible one
+            best_objective = std::min(best_objective, calculate_objective(network, distances,
+                                                                          facility_index, facility_capacity));
+            evaluated_sets++;
+        } while (next_facility_indexes(facility_index, max_index, facilities_to_locate-1));
+    } else {
+        BranchAndBound search(distances, facilities_to_locate, facility_capacity, threads);
+        best_objective = search.solve();
+        evaluated_sets = search.evaluated_sets;
     }
-    long max_index = igraph_vcount(&network.graph) - 1;
-    do {
-        best_objective = std::min(best_objective, calculate_objective(network, &res_matx,
-                                                                      facility_index, facility_capacity));
-    } while (next_facility_indexes(facility_index, max_index, facilities_to_locate-1));
+    auto search_finish = std::chrono::high_resolution_clock::now();
 
     ofstream outf(outfilename, ios::out);
     outf << "{";
@@ -149,6 +158,8 @@ int main(int argc, const char** argv) {
     outf << "\"number of facilities\": " << facilities_to_locate << ",";
     outf << "\"capacity of facilities\":" << facility_capacity << ",";
     outf << "\"objective\":" << best_objective << ",";
+    outf << "\"evaluated sets\":" << evaluated_sets << ",";
+    outf << "\"search runtime\":" << std::chrono::duration_cast<std::chrono::seconds>(search_finish-finish).count() << ",";
     outf << "\"runtime\":" << std::chrono::duration_cast<std::chrono::seconds>(finish-start).count();
     outf << "}";
     outf.close();
@@ -0,0 +1,81 @@
+/*
+ * Distance matrix of a network for external solvers (scripts/solveGurobi.py), see DistanceMatrix.h for the format
+ *
+ * sta: sources (customers) to all nodes, stt: sources to targets (potential facilities), ttt: targets to targets
+ */
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <boost/program_options.hpp>
+
+#include "helpers.h"
+#include "Network.h"
+#include "DistanceMatrix.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, const char** argv) {
+    string filename;
+    string facilityfilename;
+    string outfilename;
+    string mode;
+    long nearest;
+    unsigned threads;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("help,h", "produce help message")
+            ("input,i", po::value<string>(&filename)->required(), "Input file, a network (.ntw or .ntwb)")
+            ("facilityfile,f", po::value<string>(&facilityfilename)->default_value(""), "List of potential facilities, all nodes by default")
+            ("mode,m", po::value<string>(&mode)->default_value("stt"), "Rows and columns: sta, stt or ttt")
+            ("nearest,k", po::value<long>(&nearest)->default_value(0), "Keep only k closest columns per row, all if 0")
+            ("threads,t", po::value<unsigned>(&threads)->default_value(std::thread::hardware_concurrency()), "Number of threads")
+            ("output,o", po::value<string>(&outfilename)->required(), "Output file without extension, .dm and .txt (time) are created");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+        cout << desc << "\n";
+        return 1;
+    }
+    po::notify(vm);
+
+    try {
+        Network network(filename, facilityfilename);
+        std::vector<long> all_nodes(network.graph_size());
+        for (long i = 0; i < all_nodes.size(); i++) {
+            all_nodes[i] = i;
+        }
+        std::vector<long>* row_nodes;
+        std::vector<long>* column_nodes;
+        if (mode == "sta") {
+            row_nodes = &network.source_indexes;
+            column_nodes = &all_nodes;
+        } else if (mode == "stt") {
+            row_nodes = &network.source_indexes;
+            column_nodes = &network.target_indexes;
+        } else if (mode == "ttt") {
+            row_nodes = &network.target_indexes;
+            column_nodes = &network.target_indexes;
+        } else {
+            throw std::invalid_argument("Unknown mode " + mode);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        DistanceMatrix<long> distances(network.csr, *row_nodes, *column_nodes, threads, nearest);
+        auto finish = std::chrono::high_resolution_clock::now();
+        distances.save(outfilename + DISTMATRIX_EXTENSION);
+
+        ofstream outf(outfilename + ".txt", ios::out);
+        outf << std::chrono::duration_cast<std::chrono::duration<double>>(finish-start).count();
+        outf.close();
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,5 +2,5 @@
 GRAPH_DATA="clustered/k_n10000m1000c10cl20"
 for filename in $DATA_PATH/$GRAPH_DATA/*.ntw; do
 	echo $filename
-	python $FCLA_ROOT/scripts/calculateDistMatrSTA.py $filename None $DATA_PATH/$GRAPH_DATA/$(basename $filename)
+	$FCLA_ROOT/bin/distmatrix -i $filename -m sta -o $DATA_PATH/$GRAPH_DATA/$(basename $filename)
 done
@@ -55,6 +55,7 @@ int main(int argc, const char** argv) {
     long clusters;
     bool connected;
     bool repeat;
+    bool binary;
 
     po::options_description desc("Allowed options");
     desc.add_options()
@@ -66,7 +67,8 @@ int main(int argc, const char** argv) {
 	        ("connected,u", po::value<bool>(&connected)->default_value(false), "Force to have one component")
             ("clusters,c", po::value<long>(&clusters)->default_value(1), "Number of clusters")
             ("repeat,r", po::value<bool>(&repeat)->default_value(false), "Allow multiple customers per node")
-            ("sources,s", po::value<long>(&sources)->default_value(1), "Number of Sources (customers)");
+            ("sources,s", po::value<long>(&sources)->default_value(1), "Number of Sources (customers)")
+            ("binary,b", po::value<bool>(&binary)->default_value(false), "Save in binary format (.ntwb)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -287,6 +289,10 @@ int main(int argc, const char** argv) {
     }
 
     Network network(&graph, weights, source_indexes, coords);
-    network.save(outdir);
+    if (binary) {
+        network.save_binary(outdir);
+    } else {
+        network.save(outdir);
+    }
     igraph_destroy(&graph);
 }
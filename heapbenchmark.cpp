@@ -0,0 +1,119 @@
+/*
+ * Compare heap policies on Dijkstra workloads of a network (e.g. produced by generator):
+ * incremental exploration from every customer and SIA matching to potential facilities of the network
+ * (all nodes without customers if no list of facilities is given)
+ */
+
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+
+#include "helpers.h"
+#include "Network.h"
+#include "ExploringEdgeGenerator.h"
+#include "TargetExploringEdgeGenerator.h"
+#include "Matcher.h"
+#include "Logger.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+/*
+ * Get <edges> nearest nodes of every customer (all reachable nodes if edges is 0), return checksum of distances
+ */
+template<class Heap>
+long benchmarkExploration(Network& network, long edges, long repeat, Logger& logger, std::string name) {
+    long checksum = 0;
+    logger.start(name);
+    for (long r = 0; r < repeat; r++) {
+        ExploringEdgeGenerator<long, long, Heap> generator(network);
+        for (long i = 0; i < generator.n; i++) {
+            for (long k = 0; (edges == 0 || k < edges) && !generator.isComplete(i); k++) {
+                checksum += generator.getEdge(i).weight;
+            }
+        }
+    }
+    logger.finish(name);
+    return checksum;
+}
+
+template<class Heap>
+long benchmarkMatching(Network& network, std::vector<long>& targets, long capacity, long repeat,
+                       Logger& logger, std::string name) {
+    long result = 0;
+    logger.start(name);
+    for (long r = 0; r < repeat; r++) {
+        TargetExploringEdgeGenerator<long, long> generator(network, targets);
+        std::vector<long> excess(generator.n + generator.m, capacity);
+        for (long i = 0; i < generator.n; i++) {
+            excess[i] = -1;
+        }
+        Matcher<long, long, long, Heap> matcher(&generator, excess, &logger);
+        matcher.match();
+        matcher.calculateResult();
+        result = matcher.result_weight;
+    }
+    logger.finish(name);
+    return result;
+}
+
+int main(int argc, const char** argv) {
+    string filename;
+    string facility_filename;
+    long edges;
+    long capacity;
+    long repeat;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("help,h", "produce help message")
+            ("input,i", po::value<string>(&filename)->required(), "Input file, a network")
+            ("facilities,f", po::value<string>(&facility_filename)->default_value(""), "File with potential facilities for matching")
+            ("edges,k", po::value<long>(&edges)->default_value(0), "Nearest nodes explored per customer, 0 - all")
+            ("faccap,c", po::value<long>(&capacity)->default_value(1), "Capacity of facilities for matching")
+            ("repeat,r", po::value<long>(&repeat)->default_value(1), "Number of repetitions");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+        cout << desc << "\n";
+        return 1;
+    }
+    po::notify(vm);
+
+    Network network(filename, facility_filename);
+    Logger logger;
+
+    std::vector<std::string> names = {"binary", "4-ary", "radix"};
+    std::vector<long> checksums;
+    checksums.push_back(benchmarkExploration<fHeap<long,long>>(network, edges, repeat, logger, "exploration binary"));
+    checksums.push_back(benchmarkExploration<DaryHeap<long,long,4>>(network, edges, repeat, logger, "exploration 4-ary"));
+    checksums.push_back(benchmarkExploration<RadixHeap<long,long>>(network, edges, repeat, logger, "exploration radix"));
+    for (long i = 0; i < names.size(); i++) {
+        cout << "exploration " << names[i] << " " << logger.float_dict["exploration " + names[i]][0]
+             << " " << checksums[i] << endl;
+    }
+
+    std::vector<long> targets = network.target_indexes;
+    if (facility_filename == "") {
+        targets.clear();
+        std::vector<bool> has_customer(network.graph_size(), false);
+        for (long i = 0; i < network.source_indexes.size(); i++) {
+            has_customer[network.source_indexes[i]] = true;
+        }
+        for (long v = 0; v < network.graph_size(); v++) {
+            if (!has_customer[v]) {
+                targets.push_back(v);
+            }
+        }
+    }
+
+    //radix heap is not applicable to matching: keys are not monotone
+    long binary_result = benchmarkMatching<fHeap<long,long>>(network, targets, capacity, repeat, logger,
+                                                              "matching binary");
+    long dary_result = benchmarkMatching<DaryHeap<long,long,4>>(network, targets, capacity, repeat, logger,
+                                                                "matching 4-ary");
+    cout << "matching binary " << logger.float_dict["matching binary"][0] << " " << binary_result << endl;
+    cout << "matching 4-ary " << logger.float_dict["matching 4-ary"][0] << " " << dary_result << endl;
+    return 0;
+}
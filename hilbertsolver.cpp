@@ -10,6 +10,7 @@
 #include <boost/program_options.hpp>
 
 #include "HilbertSolver.h"
+#include "LagrangianBound.h"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -19,7 +20,9 @@ int main(int argc, const char** argv) {
     long facility_number_to_locate;
     long facility_capacity;
     string out_filename;
+    bool use_ch;
     string facilityfile;
+    long bound_candidates;
 
     po::options_description desc("Allowed options");
     desc.add_options()
@@ -28,6 +31,8 @@ int main(int argc, const char** argv) {
             ("facilityfile,f", po::value<string>(&facilityfile)->default_value(""), "File with a list of facilities")
             ("facilities,n", po::value<long>(&facility_number_to_locate)->required(), "Facilities to locate")
             ("faccap,c", po::value<long>(&facility_capacity)->default_value(1), "Capacity of facilities")
+            ("ch", po::value<bool>(&use_ch)->default_value(false), "Compute distances with a contraction hierarchy of the network")
+            ("lowerbound,b", po::value<long>(&bound_candidates)->default_value(0), "Lagrangian lower bound over this many nearest facilities per customer, 0 - disabled")
             ("output,o", po::value<string>(&out_filename)->required(), "Output file");
 
     po::variables_map vm;
@@ -48,7 +53,11 @@ int main(int argc, const char** argv) {
     try {
         Network net(filename,facilityfile);
         HilbertSolver hilbert_solver = HilbertSolver(&net, &logger);
+        hilbert_solver.use_ch = use_ch;
         hilbert_solver.run(facility_number_to_locate, facility_capacity);
+        if (bound_candidates > 0) {
+            log_lagrangian_bound(net, facility_number_to_locate, facility_capacity, bound_candidates, use_ch, &logger);
+        }
         if (logger.str_dict.count("error") > 0) {
             cout << "Error " << logger.str_dict["error"][0] << endl;
         } else {
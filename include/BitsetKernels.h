@@ -0,0 +1,118 @@
+/*
+ * Kernels over customer bitsets of 64-bit words, used by the set cover on dense matchings.
+ *
+ * The instruction set is chosen at compile time: AVX-512 with VPOPCNTDQ, AVX2 (popcount by a nibble lookup
+ * table), or a portable loop over __builtin_popcountll. Build with NATIVE_ARCH=ON (-march=native) to enable
+ * vector kernels and hardware popcount on a machine that supports them.
+ */
+
+#ifndef FCLA_BITSETKERNELS_H
+#define FCLA_BITSETKERNELS_H
+
+#include <cstdint>
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Hardware popcount is available, otherwise bitsets do not pay off
+ */
+inline bool bitset_kernels_are_fast() {
+#if defined(__AVX2__) || defined(__POPCNT__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline long bitset_words(long bits) {
+    return (bits + 63) / 64;
+}
+
+inline void bitset_set(uint64_t* bitset, long bit) {
+    bitset[bit >> 6] |= (uint64_t) 1 << (bit & 63);
+}
+
+inline bool bitset_test(const uint64_t* bitset, long bit) {
+    return (bitset[bit >> 6] >> (bit & 63)) & 1;
+}
+
+inline const char* bitset_kernel_name() {
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    return "avx512";
+#elif defined(__AVX2__)
+    return "avx2";
+#else
+    return "scalar";
+#endif
+}
+
+#if defined(__AVX2__) && !(defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__))
+/*
+ * Popcount of each 64-bit lane: bit counts of nibbles by a shuffle lookup, bytes summed by SAD
+ */
+inline __m256i popcount_epi64_avx2(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, low_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+#endif
+
+/*
+ * Number of bits set in <a> and not set in <b>: customers of a facility not covered yet
+ */
+inline long bitset_count_andnot(const uint64_t* a, const uint64_t* b, long words) {
+    long count = 0;
+    long i = 0;
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    __m512i sum = _mm512_setzero_si512();
+    for (; i + 8 <= words; i += 8) {
+        __m512i va = _mm512_loadu_si512((const void*) (a + i));
+        __m512i vb = _mm512_loadu_si512((const void*) (b + i));
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(_mm512_andnot_si512(vb, va)));
+    }
+    count += _mm512_reduce_add_epi64(sum);
+#elif defined(__AVX2__)
+    __m256i sum = _mm256_setzero_si256();
+    for (; i + 4 <= words; i += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+        sum = _mm256_add_epi64(sum, popcount_epi64_avx2(_mm256_andnot_si256(vb, va)));
+    }
+    count += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1)
+             + _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+#endif
+    for (; i < words; i++) {
+        count += __builtin_popcountll(a[i] & ~b[i]);
+    }
+    return count;
+}
+
+/*
+ * dst |= src
+ */
+inline void bitset_or(uint64_t* dst, const uint64_t* src, long words) {
+    long i = 0;
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+    for (; i + 8 <= words; i += 8) {
+        __m512i v = _mm512_or_si512(_mm512_loadu_si512((const void*) (dst + i)),
+                                    _mm512_loadu_si512((const void*) (src + i)));
+        _mm512_storeu_si512((void*) (dst + i), v);
+    }
+#elif defined(__AVX2__)
+    for (; i + 4 <= words; i += 4) {
+        __m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i*) (dst + i)),
+                                    _mm256_loadu_si256((const __m256i*) (src + i)));
+        _mm256_storeu_si256((__m256i*) (dst + i), v);
+    }
+#endif
+    for (; i < words; i++) {
+        dst[i] |= src[i];
+    }
+}
+
+#endif //FCLA_BITSETKERNELS_H
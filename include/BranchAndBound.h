@@ -0,0 +1,285 @@
+/*
+ * Exact capacitated facility location over a distance matrix by branch and bound.
+ *
+ * Facilities are chosen one by one among the columns (candidates), sorted by their total distance to customers,
+ * so good sets are met early. A partial set is pruned if a lower bound of its extensions is not better than the
+ * best objective. Both bounds ignore capacities: every customer goes to its closest facility among the chosen ones
+ * and all candidates that can still be chosen; or the current cost is decreased by the largest gains of as many
+ * candidates as facilities are left, since the gain of a candidate only shrinks as others are added. A complete set
+ * is evaluated by a min cost flow on one network per thread, built once, only arc costs change between sets.
+ * Subtrees of the first chosen candidate are distributed over threads.
+ */
+
+#ifndef FCLA_BRANCHANDBOUND_H
+#define FCLA_BRANCHANDBOUND_H
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <climits>
+#include <functional>
+#include <lemon/list_graph.h>
+#include <lemon/cost_scaling.h>
+#include "DistanceMatrix.h"
+
+class BranchAndBound {
+public:
+    static long infeasible() {
+        return LONG_MAX;
+    }
+
+    const DistanceMatrix<long>& distances;
+    long customers;
+    long candidates;
+    long facilities;
+    long capacity;
+    unsigned threads;
+
+    std::vector<long> order; //candidate columns in the order they are branched on
+    std::vector<long> suffix_min; //customer i: closest distance to order[p..] is at i*(candidates+1)+p
+
+    long best_objective = infeasible();
+    std::vector<long> best_set; //columns of the best facilities
+    std::mutex best_mutex;
+    std::atomic<long> shared_best;
+    std::atomic<long> evaluated_sets;
+
+    /*
+     * Min cost flow from customers to a set of facilities, arcs of a customer to every facility slot
+     */
+    class Flow {
+    public:
+        lemon::ListDigraph g;
+        lemon::ListDigraph::ArcMap<long> capacities;
+        lemon::ListDigraph::ArcMap<long> weights;
+        lemon::ListDigraph::Node source;
+        lemon::ListDigraph::Node target;
+        std::vector<lemon::ListDigraph::Arc> assignment; //customer i to slot s is at i*facilities+s
+        lemon::CostScaling<lemon::ListDigraph, long, long>* algorithm;
+        long customers;
+        long facilities;
+
+        Flow(long customers, long facilities, long capacity) : capacities(g), weights(g) {
+            this->customers = customers;
+            this->facilities = facilities;
+            std::vector<lemon::ListDigraph::Node> nodes;
+            for (long i = 0; i < customers + facilities; i++) {
+                nodes.push_back(g.addNode());
+            }
+            source = g.addNode();
+            target = g.addNode();
+            for (long i = 0; i < customers; i++) {
+                for (long s = 0; s < facilities; s++) {
+                    assignment.push_back(g.addArc(nodes[i], nodes[customers + s]));
+                }
+            }
+            for (long i = 0; i < customers; i++) {
+                lemon::ListDigraph::Arc e = g.addArc(source, nodes[i]);
+                capacities[e] = 1;
+                weights[e] = 0;
+            }
+            for (long s = 0; s < facilities; s++) {
+                lemon::ListDigraph::Arc e = g.addArc(nodes[customers + s], target);
+                capacities[e] = capacity;
+                weights[e] = 0;
+            }
+            algorithm = new lemon::CostScaling<lemon::ListDigraph, long, long>(g);
+        }
+        ~Flow() {
+            delete algorithm;
+        }
+
+        /*
+         * Objective of the given facility columns, infeasible() if customers can not be served
+         */
+        long solve(const DistanceMatrix<long>& distances, const std::vector<long>& set) {
+            for (long i = 0; i < customers; i++) {
+                for (long s = 0; s < facilities; s++) {
+                    long dist = distances.at(i, set[s]);
+                    lemon::ListDigraph::Arc e = assignment[i * facilities + s];
+                    capacities[e] = dist == DistanceMatrix<long>::unreachable() ? 0 : 1;
+                    weights[e] = dist == DistanceMatrix<long>::unreachable() ? 0 : dist;
+                }
+            }
+            algorithm->upperMap(capacities);
+            algorithm->costMap(weights);
+            algorithm->stSupply(source, target, customers);
+            if (algorithm->run() != lemon::CostScaling<lemon::ListDigraph, long, long>::OPTIMAL) {
+                return infeasible();
+            }
+            return algorithm->totalCost();
+        }
+    };
+
+    BranchAndBound(const DistanceMatrix<long>& distances, long facilities, long capacity, unsigned threads = 1)
+            : distances(distances), shared_best(infeasible()), evaluated_sets(0) {
+        this->customers = distances.rows;
+        this->candidates = distances.columns;
+        this->facilities = facilities;
+        this->capacity = capacity;
+        this->threads = std::max(threads, 1u);
+
+        std::vector<std::pair<long,long>> total(candidates); //sum of distances (saturated), column
+        for (long j = 0; j < candidates; j++) {
+            long sum = 0;
+            for (long i = 0; i < customers && sum != infeasible(); i++) {
+                sum = saturated_add(sum, distances.at(i, j));
+            }
+            total[j] = std::make_pair(sum, j);
+        }
+        std::sort(total.begin(), total.end());
+        order.resize(candidates);
+        for (long p = 0; p < candidates; p++) {
+            order[p] = total[p].second;
+        }
+
+        suffix_min.assign(customers * (candidates + 1), DistanceMatrix<long>::unreachable());
+        for (long i = 0; i < customers; i++) {
+            long* row = &suffix_min[i * (candidates + 1)];
+            for (long p = candidates - 1; p >= 0; p--) {
+                row[p] = std::min(row[p + 1], distances.at(i, order[p]));
+            }
+        }
+    }
+
+    static inline long saturated_add(long a, long b) {
+        return (a == infeasible() || b == infeasible() || a > infeasible() - b) ? infeasible() : a + b;
+    }
+
+    /*
+     * Lower bound of all sets that extend the chosen facilities by candidates order[next..]
+     */
+    long bound(const std::vector<long>& nearest, long next) const {
+        long result = 0;
+        for (long i = 0; i < customers; i++) {
+            long dist = std::min(nearest[i], suffix_min[i * (candidates + 1) + next]);
+            result = saturated_add(result, dist);
+            if (result == infeasible()) {
+                break;
+            }
+        }
+        return result;
+    }
+
+    /*
+     * Buffers of one thread
+     */
+    struct Search {
+        Flow flow;
+        std::vector<long> set;
+        std::vector<std::vector<long>> nearest; //nearest[d]: distances of customers to the first d chosen facilities
+        std::vector<std::vector<long>> gains; //gains[d][q]: decrease of the sum of nearest[d] by candidate order[q]
+        std::vector<long> top;
+
+        Search(long customers, long candidates, long facilities, long capacity)
+                : flow(customers, facilities, capacity), set(facilities),
+                  nearest(facilities + 1, std::vector<long>(customers, DistanceMatrix<long>::unreachable())),
+                  gains(facilities + 1, std::vector<long>(candidates)) {}
+    };
+
+    /*
+     * Best objective over all sets of <facilities> distinct candidates, infeasible() if there is none
+     */
+    long solve() {
+        if (facilities > candidates || facilities <= 0 || customers > facilities * capacity) {
+            return infeasible();
+        }
+        std::atomic<long> next_first(0);
+        auto worker = [this, &next_first]() {
+            Search search(this->customers, this->candidates, this->facilities, this->capacity);
+            long p;
+            while ((p = next_first.fetch_add(1)) <= this->candidates - this->facilities) {
+                if (this->bound(search.nearest[0], p) < this->shared_best.load()) {
+                    this->branch(search, 0, p);
+                }
+            }
+        };
+        if (threads <= 1) {
+            worker();
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++) {
+                workers.push_back(std::thread(worker));
+            }
+            for (long t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+        }
+        return best_objective;
+    }
+
+    /*
+     * Choose candidate order[p] as facility number <depth> and explore sets that extend it
+     */
+    void branch(Search& search, long depth, long p) {
+        search.set[depth] = order[p];
+        std::vector<long>& current = search.nearest[depth + 1];
+        long total = 0;
+        for (long i = 0; i < customers; i++) {
+            current[i] = std::min(search.nearest[depth][i], distances.at(i, order[p]));
+            total = saturated_add(total, current[i]);
+        }
+        long left = facilities - depth - 1;
+        if (left == 0) {
+            if (total >= shared_best.load()) {
+                return;
+            }
+            long objective = search.flow.solve(distances, search.set);
+            evaluated_sets++;
+            update(objective, search.set);
+            return;
+        }
+        if (bound(current, p + 1) >= shared_best.load()) {
+            return;
+        }
+        long last = candidates - left;
+        if (total == infeasible()) { //some customers are not reached yet, gains are not bounded
+            for (long q = p + 1; q <= last; q++) {
+                branch(search, depth + 1, q);
+            }
+            return;
+        }
+
+        //summed row by row, the distance matrix is stored by customers
+        std::vector<long>& gain = search.gains[depth + 1];
+        std::fill(gain.begin() + p + 1, gain.end(), 0);
+        for (long i = 0; i < customers; i++) {
+            for (long q = p + 1; q < candidates; q++) {
+                long dist = distances.at(i, order[q]);
+                if (dist < current[i]) {
+                    gain[q] += current[i] - dist;
+                }
+            }
+        }
+        //the largest <left> gains, the first left-1 of them are not smaller than top[left-1]
+        search.top.assign(gain.begin() + p + 1, gain.end());
+        std::nth_element(search.top.begin(), search.top.begin() + left - 1, search.top.end(), std::greater<long>());
+        long top_gains = 0;
+        for (long k = 0; k < left; k++) {
+            top_gains += search.top[k];
+        }
+        if (total - top_gains >= shared_best.load()) {
+            return;
+        }
+        long rest_gains = top_gains - search.top[left - 1]; //of the facilities after the next one
+        for (long q = p + 1; q <= last; q++) {
+            if (total - gain[q] - rest_gains >= shared_best.load()) {
+                continue;
+            }
+            branch(search, depth + 1, q);
+        }
+    }
+
+    void update(long objective, const std::vector<long>& set) {
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if (objective < best_objective) {
+            best_objective = objective;
+            best_set = set;
+            shared_best.store(objective);
+        }
+    }
+};
+
+#endif //FCLA_BRANCHANDBOUND_H
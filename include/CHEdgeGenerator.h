@@ -0,0 +1,201 @@
+/*
+ * Edge generator over a contraction hierarchy: yields for each customer the given potential facilities
+ * in increasing distance order, like TargetExploringEdgeGenerator, but without exploring the network.
+ *
+ * Bucket-based many-to-many: an upward search from every facility stores (facility, distance) in a bucket
+ * of every node it settles. An upward search from a customer scans buckets of its settled nodes and
+ * obtains distances to all reachable facilities. Facilities are handed out in batches of growing size,
+ * the next batch is selected by a repeated query, so memory per customer stays small.
+ */
+
+#ifndef FCLA_CHEDGEGENERATOR_H
+#define FCLA_CHEDGEGENERATOR_H
+
+#include <vector>
+#include <algorithm>
+#include "EdgeGenerator.h"
+#include "ExploringEdgeGenerator.h"
+#include "TargetExploringEdgeGenerator.h"
+#include "ContractionHierarchy.h"
+#include "Network.h"
+
+template<typename I, typename W>
+class CHEdgeGenerator : public EdgeGenerator {
+public:
+    long first_batch_size = 8; //facilities selected by the first query of a customer, doubled for each next one
+
+    const ContractionHierarchy* ch;
+    std::vector<I> source_node_index;
+    std::vector<long> target_indexes;
+    std::vector<long> reverse_index;
+
+    //buckets: entries of node x are in [bucket_offsets[x], bucket_offsets[x+1])
+    std::vector<long> bucket_offsets;
+    std::vector<std::pair<long,W>> bucket_entries; //facility id, distance from the facility up to the node
+
+    //per customer: current batch sorted by (distance, facility id), position in it, size of the next batch
+    std::vector<std::vector<std::pair<W,long>>> batch;
+    std::vector<long> batch_cursor;
+    std::vector<long> next_batch_size;
+    std::vector<bool> exhausted;
+
+    //query buffers, distances to facilities are valid if stamped with the current query
+    ExplorationState<long,long> search_state;
+    std::vector<std::pair<long,long>> search_space;
+    std::vector<W> facility_dist;
+    std::vector<unsigned> facility_stamp;
+    std::vector<long> reached;
+    unsigned query = 0;
+
+    CHEdgeGenerator(Network& network, std::vector<long>& target_indexes) {
+        this->ch = network.get_ch();
+        this->n = network.source_indexes.size();
+        this->m = target_indexes.size();
+        this->source_node_index = network.source_indexes;
+        this->target_indexes = target_indexes;
+        this->reverse_index.assign(network.graph_size(), -1);
+        for (long i = 0; i < target_indexes.size(); i++) {
+            this->reverse_index[target_indexes[i]] = i;
+        }
+        buildBuckets();
+        facility_dist.resize(this->m);
+        facility_stamp.assign(this->m, 0);
+        this->reset();
+    }
+    ~CHEdgeGenerator() {}
+
+    void buildBuckets() {
+        std::vector<long> entry_node;
+        std::vector<std::pair<long,W>> entries;
+        for (long j = 0; j < target_indexes.size(); j++) {
+            ch->upwardSearch(target_indexes[j], search_state, search_space);
+            for (long k = 0; k < search_space.size(); k++) {
+                entry_node.push_back(search_space[k].first);
+                entries.push_back(std::make_pair(j, search_space[k].second));
+            }
+        }
+        //counting sort of entries by node
+        bucket_offsets.assign(ch->node_count() + 1, 0);
+        for (long k = 0; k < entry_node.size(); k++) {
+            bucket_offsets[entry_node[k] + 1]++;
+        }
+        for (long x = 0; x < ch->node_count(); x++) {
+            bucket_offsets[x + 1] += bucket_offsets[x];
+        }
+        bucket_entries.resize(entries.size());
+        std::vector<long> next(bucket_offsets.begin(), bucket_offsets.end() - 1);
+        for (long k = 0; k < entries.size(); k++) {
+            bucket_entries[next[entry_node[k]]++] = entries[k];
+        }
+    }
+
+    long get_facility_id_by_node_id(long node_id) {
+        return this->reverse_index[node_id];
+    }
+
+    /*
+     * Distances from a customer to all reachable facilities, facility ids are collected in <reached>
+     */
+    void queryCustomer(long customer_id) {
+        query++;
+        if (query == 0) {
+            std::fill(facility_stamp.begin(), facility_stamp.end(), 0);
+            query = 1;
+        }
+        reached.clear();
+        ch->upwardSearch(source_node_index[customer_id], search_state, search_space);
+        for (long k = 0; k < search_space.size(); k++) {
+            long x = search_space[k].first;
+            W up_dist = search_space[k].second;
+            for (long e = bucket_offsets[x]; e < bucket_offsets[x + 1]; e++) {
+                long j = bucket_entries[e].first;
+                W dist = up_dist + bucket_entries[e].second;
+                if (facility_stamp[j] != query) {
+                    facility_stamp[j] = query;
+                    facility_dist[j] = dist;
+                    reached.push_back(j);
+                } else if (dist < facility_dist[j]) {
+                    facility_dist[j] = dist;
+                }
+            }
+        }
+    }
+
+    /*
+     * Select the next batch of a customer: closest facilities after the last handed out one
+     */
+    void nextBatch(long customer_id) {
+        std::vector<std::pair<W,long>>& customer_batch = batch[customer_id];
+        bool first = customer_batch.size() == 0;
+        std::pair<W,long> last;
+        if (!first) {
+            last = customer_batch.back();
+        }
+        queryCustomer(customer_id);
+        customer_batch.clear();
+        for (long k = 0; k < reached.size(); k++) {
+            std::pair<W,long> candidate(facility_dist[reached[k]], reached[k]);
+            if (first || last < candidate) {
+                customer_batch.push_back(candidate);
+            }
+        }
+        long size = next_batch_size[customer_id];
+        if (customer_batch.size() > size) {
+            std::nth_element(customer_batch.begin(), customer_batch.begin() + size, customer_batch.end());
+            customer_batch.resize(size);
+        } else {
+            exhausted[customer_id] = true; //all remaining facilities are in this batch
+        }
+        std::sort(customer_batch.begin(), customer_batch.end());
+        batch_cursor[customer_id] = 0;
+        next_batch_size[customer_id] *= 2;
+    }
+
+    bool isComplete(long vid) override {
+        if (batch_cursor[vid] < batch[vid].size()) {
+            return false;
+        }
+        if (exhausted[vid]) {
+            return true;
+        }
+        nextBatch(vid);
+        return batch[vid].size() == 0;
+    }
+
+    newEdge getEdge(long vid) override {
+        newEdge e;
+        if ((vid >= this->n) || (isComplete(vid))) {
+            e.exists = false;
+        } else {
+            std::pair<W,long>& facility = batch[vid][batch_cursor[vid]++];
+            e.exists = true;
+            e.capacity = 1;
+            e.source_node = vid;
+            e.target_node = this->n + facility.second;
+            e.weight = facility.first;
+            edgeMemory.push_back(e);
+        }
+        return e;
+    }
+
+    void reset() override {
+        edgeMemory.clear();
+        batch.assign(this->n, std::vector<std::pair<W,long>>());
+        batch_cursor.assign(this->n, 0);
+        next_batch_size.assign(this->n, first_batch_size);
+        exhausted.assign(this->n, false);
+    }
+};
+
+/*
+ * Generator of edges to the given potential facilities: contraction hierarchy or plain exploration with Heap
+ */
+template<class Heap = fHeap<long,long>>
+EdgeGenerator* make_target_edge_generator(Network& network, std::vector<long>& target_indexes, bool use_ch) {
+    if (use_ch) {
+        return new CHEdgeGenerator<long, long>(network, target_indexes);
+    }
+    return new TargetExploringEdgeGenerator<long, long, Heap>(network, target_indexes);
+}
+
+#endif //FCLA_CHEDGEGENERATOR_H
@@ -0,0 +1,180 @@
+/*
+ * Compressed sparse row adjacency of an undirected road network.
+ *
+ * Every edge {from,to} is stored twice (from->to and to->from), weights are inlined next to neighbor ids,
+ * so a traversal of a node is a linear scan over one contiguous block without any lookups.
+ * Neighbors of each node are sorted by id, that is the same order as igraph_neighbors returns.
+ */
+
+#ifndef FCLA_CSRGRAPH_H
+#define FCLA_CSRGRAPH_H
+
+#include <vector>
+#include <algorithm>
+#include <igraph/igraph.h>
+
+class CSRGraph {
+public:
+    struct Arc {
+        long target;
+        long weight;
+    };
+
+    std::vector<long> offsets; // arcs of node v are in [offsets[v], offsets[v+1])
+    std::vector<Arc> arcs;
+
+    //arrays used by traversal: either data of the vectors above or external memory (e.g. a mapped file)
+    const long* offset_view = nullptr;
+    const Arc* arc_view = nullptr;
+    long view_node_count = 0;
+    long view_arc_count = 0;
+
+    CSRGraph() {}
+    CSRGraph(const CSRGraph& other) {
+        *this = other;
+    }
+    CSRGraph& operator=(const CSRGraph& other) {
+        offsets = other.offsets;
+        arcs = other.arcs;
+        if (other.is_owner()) {
+            own_views();
+        } else {
+            attach(other.offset_view, other.arc_view, other.view_node_count);
+        }
+        return *this;
+    }
+
+    inline bool is_owner() const {
+        return offset_view == nullptr || offset_view == offsets.data();
+    }
+
+    void own_views() {
+        offset_view = offsets.data();
+        arc_view = arcs.data();
+        view_node_count = offsets.size() == 0 ? 0 : offsets.size() - 1;
+        view_arc_count = arcs.size();
+    }
+
+    /*
+     * Use external arrays without copying: offsets of size node_count+1 and arcs of size offsets[node_count].
+     * The memory must outlive the graph.
+     */
+    void attach(const long* external_offsets, const Arc* external_arcs, long node_count) {
+        offsets.clear();
+        arcs.clear();
+        offset_view = external_offsets;
+        arc_view = external_arcs;
+        view_node_count = node_count;
+        view_arc_count = node_count > 0 ? external_offsets[node_count] : 0;
+    }
+
+    /*
+     * Build from a flat list of edges: edges[2*i], edges[2*i+1] are endpoints of edge i with weight edge_weights[i]
+     */
+    void build(long node_count, const std::vector<long>& edges, const std::vector<long>& edge_weights) {
+        long edge_count = edges.size() / 2;
+        offsets.assign(node_count + 1, 0);
+        for (long i = 0; i < edge_count; i++) {
+            offsets[edges[2*i] + 1]++;
+            offsets[edges[2*i + 1] + 1]++;
+        }
+        for (long v = 0; v < node_count; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        arcs.resize(2 * edge_count);
+        std::vector<long> next(offsets.begin(), offsets.end() - 1);
+        for (long i = 0; i < edge_count; i++) {
+            long from = edges[2*i];
+            long to = edges[2*i + 1];
+            arcs[next[from]++] = {to, edge_weights[i]};
+            arcs[next[to]++] = {from, edge_weights[i]};
+        }
+        for (long v = 0; v < node_count; v++) {
+            std::sort(arcs.begin() + offsets[v], arcs.begin() + offsets[v + 1], [](const Arc& a, const Arc& b) {
+                return a.target < b.target;
+            });
+        }
+        own_views();
+    }
+
+    /*
+     * Interoperability with igraph: edge ids of the igraph correspond to indexes in edge_weights
+     */
+    void build(const igraph_t* g, const std::vector<long>& edge_weights) {
+        long edge_count = igraph_ecount(g);
+        std::vector<long> edges(2 * edge_count);
+        for (long i = 0; i < edge_count; i++) {
+            igraph_integer_t from, to;
+            igraph_edge(g, i, &from, &to);
+            edges[2*i] = from;
+            edges[2*i + 1] = to;
+        }
+        build(igraph_vcount(g), edges, edge_weights);
+    }
+
+    inline long node_count() const {
+        return view_node_count;
+    }
+
+    inline long edge_count() const {
+        return view_arc_count / 2;
+    }
+
+    inline long degree(long v) const {
+        return offset_view[v + 1] - offset_view[v];
+    }
+
+    inline const Arc* begin(long v) const {
+        return arc_view + offset_view[v];
+    }
+
+    inline const Arc* end(long v) const {
+        return arc_view + offset_view[v + 1];
+    }
+
+    /*
+     * Neighbors are sorted, so a repeated neighbor is always adjacent to its copy.
+     * Self-loops are stored twice by construction and are not counted as multiple edges.
+     */
+    bool has_multiple_edges() const {
+        for (long v = 0; v < node_count(); v++) {
+            for (const Arc* a = begin(v); a + 1 < end(v); a++) {
+                if (a->target == (a + 1)->target && a->target != v) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Label weakly connected components by BFS, return number of components.
+     * Components are numbered in the order of their smallest node id (same as igraph_clusters).
+     */
+    long weak_components(std::vector<long>& membership) const {
+        long n = node_count();
+        membership.assign(n, -1);
+        std::vector<long> queue;
+        queue.reserve(n);
+        long components = 0;
+        for (long s = 0; s < n; s++) {
+            if (membership[s] != -1) continue;
+            membership[s] = components;
+            queue.clear();
+            queue.push_back(s);
+            for (long head = 0; head < queue.size(); head++) {
+                long v = queue[head];
+                for (const Arc* a = begin(v); a != end(v); a++) {
+                    if (membership[a->target] == -1) {
+                        membership[a->target] = components;
+                        queue.push_back(a->target);
+                    }
+                }
+            }
+            components++;
+        }
+        return components;
+    }
+};
+
+#endif //FCLA_CSRGRAPH_H
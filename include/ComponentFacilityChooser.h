@@ -0,0 +1,284 @@
+/*
+ * Facility location solved independently per weak component of the network.
+ *
+ * Customers of different components are never matched to each other's facilities, so every component with
+ * customers becomes a separate instance: facilities are allocated to components (at least enough to serve
+ * all customers of a component, the rest proportionally to the number of customers), and each component is
+ * solved by its own FacilityChooser. Components are solved concurrently, largest first; results, objectives
+ * and logs are merged into the parent logger.
+ */
+
+#ifndef FCLA_COMPONENTFACILITYCHOOSER_H
+#define FCLA_COMPONENTFACILITYCHOOSER_H
+
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+#include "FacilityChooser.h"
+#include "Network.h"
+#include "Logger.h"
+#include "exceptions.h"
+
+class ComponentFacilityChooser {
+public:
+    Network* network;
+    Logger* logger;
+    long required_facilities;
+    long facility_capacity;
+    long lambda;
+    double alpha;
+    bool partially_uniform;
+
+    //options passed to every FacilityChooser
+    bool greedyMatching = false;
+    int greedyMatchingOrder = 0;
+    int objective_matching = 1;
+    long prefetch_size = 0;
+    unsigned prefetch_threads = 1;
+    bool use_ch = false;
+
+    unsigned threads = 1; //components solved concurrently
+
+    //per solved component (components with customers only)
+    std::vector<long> component_ids;
+    std::vector<std::vector<long>> node_ids; //local node id -> node id in the network
+    std::vector<Network*> subnetworks;
+    std::vector<Logger> loggers;
+    std::vector<FacilityChooser*> choosers;
+    std::vector<long> facilities_per_component;
+
+    std::vector<long> result; //node ids of located facilities
+    long totalCost = 0;
+    FacilityChooser::State state = FacilityChooser::NOT_LOCATED;
+
+    ComponentFacilityChooser(Network& network,
+                             long facilities_to_locate,
+                             long facility_capacity,
+                             Logger* logger,
+                             long lambda = 0,
+                             double alpha = 1,
+                             bool partially_uniform = false) {
+        this->network = &network;
+        this->logger = logger;
+        this->required_facilities = facilities_to_locate;
+        this->facility_capacity = facility_capacity;
+        this->lambda = lambda;
+        this->alpha = alpha;
+        this->partially_uniform = partially_uniform;
+    }
+
+    ~ComponentFacilityChooser() {
+        for (long k = 0; k < choosers.size(); k++) {
+            delete choosers[k];
+        }
+        for (long k = 0; k < subnetworks.size(); k++) {
+            delete subnetworks[k];
+        }
+    }
+
+    /*
+     * Extract components with customers, largest first
+     */
+    void split() {
+        logger->start("split components");
+        long components = network->components();
+        std::vector<long>& membership = network->component_membership;
+        logger->add("number of components", components);
+
+        std::vector<long> customers_per_component(components, 0);
+        for (long i = 0; i < network->source_indexes.size(); i++) {
+            customers_per_component[membership[network->source_indexes[i]]]++;
+        }
+        component_ids.clear();
+        for (long c = 0; c < components; c++) {
+            if (customers_per_component[c] > 0) {
+                component_ids.push_back(c);
+            }
+        }
+        std::stable_sort(component_ids.begin(), component_ids.end(), [&customers_per_component](long a, long b) {
+            return customers_per_component[a] > customers_per_component[b];
+        });
+        subnetworks = network->extract_components(component_ids, node_ids);
+        logger->add("components with customers", component_ids.size());
+        logger->finish("split components");
+    }
+
+    long get_potential_facility_count(long k) {
+        return subnetworks[k]->target_indexes.size() == 0 ? subnetworks[k]->graph_size()
+                                                          : subnetworks[k]->target_indexes.size();
+    }
+
+    /*
+     * Minimum number of facilities serving all customers of a component, the rest in proportion to customers,
+     * never more than potential facilities of a component
+     */
+    void allocateFacilities() {
+        long total_customers = network->number_of_customers();
+        long left_facilities = required_facilities;
+        facilities_per_component.assign(subnetworks.size(), 0);
+        for (long k = 0; k < subnetworks.size(); k++) {
+            long component_customers = subnetworks[k]->number_of_customers();
+            long minrequiredfacilities = component_customers / facility_capacity;
+            if (component_customers % facility_capacity != 0) {
+                minrequiredfacilities++;
+            }
+            if (left_facilities < minrequiredfacilities || get_potential_facility_count(k) < minrequiredfacilities) {
+                throw infeasible_solution;
+            }
+            facilities_per_component[k] = minrequiredfacilities;
+            left_facilities -= minrequiredfacilities;
+        }
+        for (long k = 0; k < subnetworks.size() && left_facilities > 0; k++) {
+            double facility_fraction = (double) subnetworks[k]->number_of_customers() / (double) total_customers;
+            long facilities = (long) (facility_fraction * (double) required_facilities);
+            facilities = std::min(facilities, get_potential_facility_count(k));
+            long delta = std::min(std::max(facilities - facilities_per_component[k], 0L), left_facilities);
+            facilities_per_component[k] += delta;
+            left_facilities -= delta;
+        }
+        //rounding leftovers go to components that still have free potential facilities
+        for (long k = 0; k < subnetworks.size() && left_facilities > 0; k++) {
+            long delta = std::min(get_potential_facility_count(k) - facilities_per_component[k], left_facilities);
+            facilities_per_component[k] += delta;
+            left_facilities -= delta;
+        }
+    }
+
+    void solveComponent(long k) {
+        FacilityChooser* fcla = new FacilityChooser(*subnetworks[k], facilities_per_component[k], facility_capacity,
+                                                    &loggers[k], lambda, alpha, partially_uniform);
+        choosers[k] = fcla;
+        fcla->greedyMatching = this->greedyMatching;
+        fcla->objective_matching = this->objective_matching;
+        fcla->greedyMatchingOrder = this->greedyMatchingOrder;
+        if (this->use_ch) {
+            fcla->setContractionHierarchy(true);
+        }
+        if (this->prefetch_size > 0) {
+            fcla->setPrefetch(this->prefetch_size, this->prefetch_threads);
+        }
+        fcla->run();
+    }
+
+    void solveComponents() {
+        choosers.assign(subnetworks.size(), NULL);
+        loggers.assign(subnetworks.size(), Logger());
+        std::vector<std::exception_ptr> errors(subnetworks.size());
+        std::atomic<long> next_component(0);
+        auto worker = [this, &next_component, &errors]() {
+            long k;
+            while ((k = next_component.fetch_add(1)) < this->subnetworks.size()) {
+                try {
+                    this->solveComponent(k);
+                } catch (...) {
+                    errors[k] = std::current_exception();
+                }
+            }
+        };
+        if (threads <= 1 || subnetworks.size() < 2) {
+            worker();
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++) {
+                workers.push_back(std::thread(worker));
+            }
+            for (long t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+        }
+        for (long k = 0; k < errors.size(); k++) {
+            if (errors[k]) {
+                std::rethrow_exception(errors[k]);
+            }
+        }
+    }
+
+    /*
+     * Facilities left after allocation (no component with customers can take them) go to any free potential facility
+     */
+    void locateRest(std::vector<bool>& chosen) {
+        long facilities_left = required_facilities - result.size();
+        bool all_nodes = network->target_indexes.size() == 0;
+        long potential = all_nodes ? network->graph_size() : network->target_indexes.size();
+        for (long i = 0; i < potential && facilities_left > 0; i++) {
+            long node_id = all_nodes ? i : network->target_indexes[i];
+            if (!chosen[node_id]) {
+                chosen[node_id] = true;
+                result.push_back(node_id);
+                facilities_left--;
+            }
+        }
+    }
+
+    /*
+     * Copy component logs to the parent logger: values of the same key are concatenated in component order,
+     * keys that the parent logs for the whole network get a "component " prefix
+     */
+    void mergeLogs() {
+        std::set<std::string> prefixed({"objective", "runtime", "number of facilities", "number of components"});
+        std::set<std::string> skipped({"id", "facilities_indexes", "capacity of facilities"});
+        for (long k = 0; k < loggers.size(); k++) {
+            for (auto it = loggers[k].float_dict.begin(); it != loggers[k].float_dict.end(); it++) {
+                if (skipped.count(it->first)) {
+                    continue;
+                }
+                std::string key = prefixed.count(it->first) ? "component " + it->first : it->first;
+                std::vector<double>& values = logger->float_dict[key];
+                values.insert(values.end(), it->second.begin(), it->second.end());
+            }
+            for (auto it = loggers[k].str_dict.begin(); it != loggers[k].str_dict.end(); it++) {
+                if (skipped.count(it->first)) {
+                    continue;
+                }
+                std::string key = prefixed.count(it->first) ? "component " + it->first : it->first;
+                std::vector<std::string>& values = logger->str_dict[key];
+                values.insert(values.end(), it->second.begin(), it->second.end());
+            }
+        }
+    }
+
+    void run() {
+        logger->add("id", network->id);
+        logger->add("number of facilities", required_facilities);
+        logger->add("capacity of facilities", facility_capacity);
+        logger->add("threads", threads);
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        logger->start("cpu time");
+
+        split();
+        allocateFacilities();
+        solveComponents();
+
+        result.clear();
+        totalCost = 0;
+        std::vector<bool> chosen(network->graph_size(), false);
+        for (long k = 0; k < choosers.size(); k++) {
+            std::vector<long> local_ids = choosers[k]->get_chosen_facility_node_ids();
+            for (long i = 0; i < local_ids.size(); i++) {
+                long node_id = node_ids[k][local_ids[i]];
+                chosen[node_id] = true;
+                result.push_back(node_id);
+            }
+            totalCost += choosers[k]->totalCost;
+        }
+        locateRest(chosen);
+        state = FacilityChooser::LOCATED;
+
+        std::string facility_index_list = "";
+        for (long i = 0; i < result.size(); i++) {
+            facility_index_list += std::to_string(result[i]) + ",";
+        }
+        logger->add("facilities_indexes", facility_index_list);
+        mergeLogs();
+        logger->finish("cpu time");
+        //wall-clock time, clock() sums time of all threads
+        logger->add("runtime", std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+        logger->add("objective", totalCost);
+    }
+};
+
+#endif //FCLA_COMPONENTFACILITYCHOOSER_H
@@ -0,0 +1,214 @@
+/*
+ * Contraction hierarchy of an undirected road network.
+ *
+ * Nodes are contracted one by one in the order of their edge difference (shortcuts added minus edges removed,
+ * plus the number of already contracted neighbors for uniformity). A shortcut u-w is added for a contracted node v
+ * only if a local witness search does not find a path from u to w shorter than u-v-w avoiding v.
+ * After preprocessing only the upward graph is kept: arcs from a node to its neighbors of higher rank.
+ * A shortest path between any two nodes goes up from both ends and meets at the highest ranked node,
+ * so distances are obtained by two small upward searches.
+ */
+
+#ifndef FCLA_CONTRACTIONHIERARCHY_H
+#define FCLA_CONTRACTIONHIERARCHY_H
+
+#include <vector>
+#include <algorithm>
+#include "CSRGraph.h"
+#include "ExplorationState.h"
+#include "nheap.h"
+
+class ContractionHierarchy {
+public:
+    std::vector<long> rank; //contraction order of nodes
+    std::vector<long> up_offsets; //arcs of node v to higher ranked nodes are in [up_offsets[v], up_offsets[v+1])
+    std::vector<CSRGraph::Arc> up_arcs;
+    long shortcut_count = 0;
+
+    //witness search stops after this number of settled nodes, a shortcut is added then (correct, maybe redundant)
+    long witness_settle_limit = 500;
+
+    //state of contraction, released after build
+    std::vector<std::vector<CSRGraph::Arc>> overlay;
+    std::vector<bool> contracted;
+    std::vector<long> contracted_neighbors;
+    ExplorationState<long,long> witness;
+
+    ContractionHierarchy() {}
+
+    ContractionHierarchy(const CSRGraph& graph) {
+        this->build(graph);
+    }
+
+    inline long node_count() const {
+        return rank.size();
+    }
+
+    inline const CSRGraph::Arc* up_begin(long v) const {
+        return up_arcs.data() + up_offsets[v];
+    }
+
+    inline const CSRGraph::Arc* up_end(long v) const {
+        return up_arcs.data() + up_offsets[v + 1];
+    }
+
+    /*
+     * Add an arc to the overlay or decrease its weight if it exists (parallel edges keep the minimal weight)
+     */
+    void addOverlayArc(long from, long to, long weight) {
+        std::vector<CSRGraph::Arc>& arcs = overlay[from];
+        for (long i = 0; i < arcs.size(); i++) {
+            if (arcs[i].target == to) {
+                arcs[i].weight = std::min(arcs[i].weight, weight);
+                return;
+            }
+        }
+        arcs.push_back({to, weight});
+    }
+
+    /*
+     * Find shortcuts needed to contract v. If shortcuts is NULL only their number is returned (simulation).
+     */
+    long findShortcuts(long v, std::vector<long>* shortcuts) {
+        std::vector<CSRGraph::Arc> neighbors;
+        long max_weight = 0;
+        for (long i = 0; i < overlay[v].size(); i++) {
+            if (!contracted[overlay[v][i].target]) {
+                neighbors.push_back(overlay[v][i]);
+                max_weight = std::max(max_weight, overlay[v][i].weight);
+            }
+        }
+        long count = 0;
+        std::vector<long> witness_dist(neighbors.size());
+        for (long i = 0; i < neighbors.size(); i++) {
+            long u = neighbors[i].target;
+            long bound = neighbors[i].weight + max_weight;
+            std::fill(witness_dist.begin(), witness_dist.end(), bound + 1);
+            //local dijkstra from u that avoids v
+            witness.reset(u);
+            long x, dist;
+            long settled = 0;
+            while (settled < witness_settle_limit && witness.settle(x, dist) && dist <= bound) {
+                settled++;
+                for (long j = i + 1; j < neighbors.size(); j++) {
+                    if (neighbors[j].target == x) {
+                        witness_dist[j] = dist;
+                    }
+                }
+                for (long j = 0; j < overlay[x].size(); j++) {
+                    long y = overlay[x][j].target;
+                    if (y != v && !contracted[y]) {
+                        witness.relax(y, dist + overlay[x][j].weight);
+                    }
+                }
+            }
+            for (long j = i + 1; j < neighbors.size(); j++) {
+                long via_v = neighbors[i].weight + neighbors[j].weight;
+                if (witness_dist[j] > via_v) {
+                    count++;
+                    if (shortcuts != NULL) {
+                        shortcuts->push_back(u);
+                        shortcuts->push_back(neighbors[j].target);
+                        shortcuts->push_back(via_v);
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    long priority(long v) {
+        long degree = 0;
+        for (long i = 0; i < overlay[v].size(); i++) {
+            degree += !contracted[overlay[v][i].target];
+        }
+        return findShortcuts(v, NULL) - degree + contracted_neighbors[v];
+    }
+
+    void build(const CSRGraph& graph) {
+        long n = graph.node_count();
+        overlay.assign(n, std::vector<CSRGraph::Arc>());
+        for (long v = 0; v < n; v++) {
+            for (const CSRGraph::Arc* arc = graph.begin(v); arc != graph.end(v); arc++) {
+                if (arc->target != v) {
+                    addOverlayArc(v, arc->target, arc->weight);
+                }
+            }
+        }
+        contracted.assign(n, false);
+        contracted_neighbors.assign(n, 0);
+        rank.assign(n, -1);
+        shortcut_count = 0;
+
+        fHeap<long,long> queue;
+        for (long v = 0; v < n; v++) {
+            queue.enqueue(v, priority(v));
+        }
+        long next_rank = 0;
+        std::vector<long> shortcuts;
+        long v, old_priority;
+        while (queue.dequeue(v, old_priority)) {
+            //lazy update: priorities change when neighbors are contracted
+            long current = priority(v);
+            if (queue.size() > 0 && current > queue.getTopValue()) {
+                queue.enqueue(v, current);
+                continue;
+            }
+            shortcuts.clear();
+            findShortcuts(v, &shortcuts);
+            for (long i = 0; i < shortcuts.size(); i += 3) {
+                addOverlayArc(shortcuts[i], shortcuts[i + 1], shortcuts[i + 2]);
+                addOverlayArc(shortcuts[i + 1], shortcuts[i], shortcuts[i + 2]);
+            }
+            shortcut_count += shortcuts.size() / 3;
+            contracted[v] = true;
+            rank[v] = next_rank++;
+            for (long i = 0; i < overlay[v].size(); i++) {
+                if (!contracted[overlay[v][i].target]) {
+                    contracted_neighbors[overlay[v][i].target]++;
+                }
+            }
+        }
+
+        //extract the upward graph
+        up_offsets.assign(n + 1, 0);
+        for (long v = 0; v < n; v++) {
+            for (long i = 0; i < overlay[v].size(); i++) {
+                up_offsets[v + 1] += rank[overlay[v][i].target] > rank[v];
+            }
+        }
+        for (long v = 0; v < n; v++) {
+            up_offsets[v + 1] += up_offsets[v];
+        }
+        up_arcs.resize(up_offsets[n]);
+        for (long v = 0; v < n; v++) {
+            long pos = up_offsets[v];
+            for (long i = 0; i < overlay[v].size(); i++) {
+                if (rank[overlay[v][i].target] > rank[v]) {
+                    up_arcs[pos++] = overlay[v][i];
+                }
+            }
+        }
+        std::vector<std::vector<CSRGraph::Arc>>().swap(overlay);
+        std::vector<bool>().swap(contracted);
+        std::vector<long>().swap(contracted_neighbors);
+    }
+
+    /*
+     * Dijkstra on the upward graph from a source, returns all settled nodes with their distances.
+     * The search space is small, it is not pruned.
+     */
+    void upwardSearch(long source, ExplorationState<long,long>& state, std::vector<std::pair<long,long>>& space) const {
+        space.clear();
+        state.reset(source);
+        long x, dist;
+        while (state.settle(x, dist)) {
+            space.push_back(std::make_pair(x, dist));
+            for (const CSRGraph::Arc* arc = up_begin(x); arc != up_end(x); arc++) {
+                state.relax(arc->target, dist + arc->weight);
+            }
+        }
+    }
+};
+
+#endif //FCLA_CONTRACTIONHIERARCHY_H
@@ -0,0 +1,148 @@
+/*
+ * Indexed min-heap with D children per node, a drop-in replacement of fHeap for minimum queues.
+ *
+ * A wider node makes the tree shallower: decrease-key (the dominant operation of Dijkstra) moves up fewer levels,
+ * and children of a node are adjacent in memory when they are compared during dequeue.
+ */
+
+#ifndef FCLA_DARYHEAP_H
+#define FCLA_DARYHEAP_H
+
+#include <vector>
+
+template <class V, class I, int D = 4>
+class DaryHeap {
+public:
+    struct elem {
+        V value;
+        I idx;
+    };
+
+    std::vector<elem> heap;
+    std::vector<I> order; //position of an element in the heap, -1 if it is not in the heap
+
+    DaryHeap() {}
+
+    void clear() {
+        //positions of remaining elements are invalidated
+        for (I i = 0; i < heap.size(); i++) {
+            order[heap[i].idx] = -1;
+        }
+        heap.clear();
+    }
+
+    inline I size() const {
+        return heap.size();
+    }
+
+    inline bool isExisted(I idx) const {
+        return idx < order.size() && order[idx] != -1;
+    }
+
+    inline V getVal(I idx) const {
+        return heap[order[idx]].value;
+    }
+
+    inline V getTopValue() const {
+        return heap[0].value;
+    }
+
+    inline I getTopIdx() const {
+        return heap[0].idx;
+    }
+
+    void enqueue(I idx, V value) {
+        if (idx >= order.size()) {
+            order.resize(idx + 1, -1);
+        }
+        heap.push_back(elem());
+        moveup(heap.size() - 1, idx, value);
+    }
+
+    bool dequeue(I &idx, V &value) {
+        if (heap.size() == 0) {
+            return false;
+        }
+        idx = heap[0].idx;
+        value = heap[0].value;
+        order[idx] = -1;
+        elem last = heap.back();
+        heap.pop_back();
+        if (heap.size() > 0) {
+            movedown(0, last.idx, last.value);
+        }
+        return true;
+    }
+
+    I dequeue(I &idx) {
+        V value;
+        return dequeue(idx, value) ? 1 : 0;
+    }
+
+    void updatequeue(I idx, V new_val) {
+        I posel = order[idx];
+        if (new_val < heap[posel].value) {
+            moveup(posel, idx, new_val);
+        } else {
+            movedown(posel, idx, new_val);
+        }
+    }
+
+    bool updateorenqueue(I idx, V new_val) {
+        if (isExisted(idx)) {
+            updatequeue(idx, new_val);
+            return true;
+        }
+        enqueue(idx, new_val);
+        return false;
+    }
+
+    /*
+     * Place an element at a free position or higher (hole moves up)
+     */
+    void moveup(I posel, I idx, V value) {
+        while (posel > 0) {
+            I parent = (posel - 1) / D;
+            if (!(value < heap[parent].value)) {
+                break;
+            }
+            heap[posel] = heap[parent];
+            order[heap[posel].idx] = posel;
+            posel = parent;
+        }
+        heap[posel].value = value;
+        heap[posel].idx = idx;
+        order[idx] = posel;
+    }
+
+    /*
+     * Place an element at a free position or lower (hole moves down to the smallest child)
+     */
+    void movedown(I posel, I idx, V value) {
+        I count = heap.size();
+        while (true) {
+            I first = posel * D + 1;
+            if (first >= count) {
+                break;
+            }
+            I last = first + D < count ? first + D : count;
+            I best = first;
+            for (I c = first + 1; c < last; c++) {
+                if (heap[c].value < heap[best].value) {
+                    best = c;
+                }
+            }
+            if (!(heap[best].value < value)) {
+                break;
+            }
+            heap[posel] = heap[best];
+            order[heap[posel].idx] = posel;
+            posel = best;
+        }
+        heap[posel].value = value;
+        heap[posel].idx = idx;
+        order[idx] = posel;
+    }
+};
+
+#endif //FCLA_DARYHEAP_H
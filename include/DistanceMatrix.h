@@ -0,0 +1,187 @@
+/*
+ * Shortest path distances from row nodes (customers) to column nodes (candidate facilities).
+ *
+ * Only the rows x columns block is stored, row-major, or only the <nearest> closest columns of every row.
+ * Every distinct row node is one Dijkstra over the CSR graph that stops once all (or <nearest>) columns are
+ * settled. Rows are distributed over threads, each thread has its own exploration state and writes only its rows.
+ *
+ * Binary format (.dm): DistanceMatrixHeader, row node ids, column node ids, distances (rows x width, -1 if
+ * unreachable), and if nearest > 0 the column index of every distance (-1 if a row has fewer reachable columns).
+ * Integers are int64 in native byte order, width is nearest if it is positive and the number of columns otherwise.
+ */
+
+#ifndef FCLA_DISTANCEMATRIX_H
+#define FCLA_DISTANCEMATRIX_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include "CSRGraph.h"
+#include "ExplorationState.h"
+
+#define DISTMATRIX_MAGIC "DMTX"
+#define DISTMATRIX_VERSION 1
+#define DISTMATRIX_EXTENSION ".dm"
+
+struct DistanceMatrixHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t rows;
+    int64_t columns;
+    int64_t nearest;
+};
+
+template<typename W = long>
+class DistanceMatrix {
+public:
+    long rows = 0;
+    long columns = 0;
+    long nearest = 0; //if positive, only this many closest columns are kept per row
+    long width = 0; //stored entries per row
+    std::vector<W> distances; //distance from row i to column j is at i*columns+j, or to nearest_columns[i*nearest+k]
+    std::vector<long> nearest_columns; //if nearest > 0: columns of row i in distance order at i*nearest.., -1 if fewer
+    std::vector<long> column_of_node; //-1 if a node is not a column
+    std::vector<long> row_nodes;
+    std::vector<long> column_nodes;
+
+    static W unreachable() {
+        return std::numeric_limits<W>::max();
+    }
+
+    DistanceMatrix(const CSRGraph& csr, const std::vector<long>& row_nodes, const std::vector<long>& column_nodes,
+                   unsigned threads = 1, long nearest = 0) {
+        rows = row_nodes.size();
+        columns = column_nodes.size();
+        this->row_nodes = row_nodes;
+        this->column_nodes = column_nodes;
+        this->nearest = nearest;
+        width = nearest > 0 ? nearest : columns;
+        distances.assign(rows * width, unreachable());
+        if (nearest > 0) {
+            nearest_columns.assign(rows * width, -1);
+        }
+        column_of_node.assign(csr.node_count(), -1);
+        for (long j = 0; j < columns; j++) {
+            column_of_node[column_nodes[j]] = j;
+        }
+
+        //rows at the same node share one search, the first of them is computed and copied to the others
+        std::vector<long> first_row_of_node(csr.node_count(), -1);
+        std::vector<long> searches;
+        for (long i = 0; i < rows; i++) {
+            if (first_row_of_node[row_nodes[i]] == -1) {
+                first_row_of_node[row_nodes[i]] = i;
+                searches.push_back(i);
+            }
+        }
+        std::atomic<long> next_search(0);
+        auto worker = [this, &csr, &row_nodes, &searches, &next_search]() {
+            ExplorationState<W,long> state;
+            long k;
+            while ((k = next_search.fetch_add(1)) < searches.size()) {
+                this->computeRow(csr, searches[k], row_nodes[searches[k]], state);
+            }
+        };
+        if (threads <= 1 || searches.size() < 2) {
+            worker();
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++) {
+                workers.push_back(std::thread(worker));
+            }
+            for (long t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+        }
+        for (long i = 0; i < rows; i++) {
+            long first = first_row_of_node[row_nodes[i]];
+            if (first != i) {
+                std::copy(distances.begin() + first * width, distances.begin() + (first + 1) * width,
+                          distances.begin() + i * width);
+                if (nearest > 0) {
+                    std::copy(nearest_columns.begin() + first * width, nearest_columns.begin() + (first + 1) * width,
+                              nearest_columns.begin() + i * width);
+                }
+            }
+        }
+    }
+
+    /*
+     * Dijkstra from the node of a row until all (nearest) columns are settled or the component is exhausted
+     */
+    void computeRow(const CSRGraph& csr, long row, long source, ExplorationState<W,long>& state) {
+        W* row_distances = &distances[row * width];
+        long left = width;
+        state.reset(source);
+        long node;
+        W dist;
+        while (left > 0 && state.settle(node, dist)) {
+            long column = column_of_node[node];
+            if (column != -1 && nearest > 0) {
+                nearest_columns[row * width + width - left] = column;
+                row_distances[width - left] = dist;
+                left--;
+            } else if (column != -1 && row_distances[column] == unreachable()) {
+                row_distances[column] = dist;
+                left--;
+            }
+            for (const CSRGraph::Arc* arc = csr.begin(node); arc != csr.end(node); arc++) {
+                state.relax(arc->target, dist + arc->weight);
+            }
+        }
+    }
+
+    /*
+     * Distance from a row to a column, only if all columns are stored
+     */
+    inline W at(long row, long column) const {
+        return distances[row * columns + column];
+    }
+
+    /*
+     * Distance from a row to a column node, the node must be a column
+     */
+    inline W to_node(long row, long node) const {
+        return distances[row * columns + column_of_node[node]];
+    }
+
+    void save(const std::string& filename) const {
+        std::ofstream outf(filename, std::ios::out | std::ios::binary);
+        if (!outf) {
+            throw std::invalid_argument("Can not write distance matrix file");
+        }
+        DistanceMatrixHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, DISTMATRIX_MAGIC, 4);
+        header.version = DISTMATRIX_VERSION;
+        header.rows = rows;
+        header.columns = columns;
+        header.nearest = nearest;
+        outf.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_int64(outf, row_nodes.begin(), row_nodes.end());
+        write_int64(outf, column_nodes.begin(), column_nodes.end());
+        std::vector<int64_t> row(width);
+        for (long i = 0; i < rows; i++) {
+            for (long k = 0; k < width; k++) {
+                W dist = distances[i * width + k];
+                row[k] = dist == unreachable() ? -1 : static_cast<int64_t>(dist);
+            }
+            outf.write(reinterpret_cast<const char*>(row.data()), width * sizeof(int64_t));
+        }
+        write_int64(outf, nearest_columns.begin(), nearest_columns.end());
+    }
+
+    template<class It>
+    static void write_int64(std::ofstream& outf, It begin, It end) {
+        std::vector<int64_t> column(begin, end);
+        outf.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(int64_t));
+    }
+};
+
+#endif //FCLA_DISTANCEMATRIX_H
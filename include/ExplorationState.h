@@ -0,0 +1,137 @@
+/*
+ * State of one incremental Dijkstra execution, sized by the explored area instead of the whole network.
+ *
+ * Touched nodes get dense local ids through an open-addressing hash table, heap and settled flags work on
+ * local ids only. Hash slots are stamped with an epoch, so reset() is O(1) for the table and O(touched) for
+ * the rest, and the memory of the previous run is reused.
+ */
+
+#ifndef FCLA_EXPLORATIONSTATE_H
+#define FCLA_EXPLORATIONSTATE_H
+
+#include <vector>
+#include <cstdint>
+#include "nheap.h"
+
+/*
+ * Heap is a policy with the fHeap interface (enqueue, updatequeue, dequeue, getVal, size, clear),
+ * keys are monotone, so a RadixHeap can be used as well.
+ */
+template<typename W, typename I, class Heap = fHeap<W,I>>
+class ExplorationState {
+public:
+    static const long INITIAL_CAPACITY = 16; //must be a power of two
+
+    //hash table: node id -> local id, a slot is empty if its stamp differs from the current epoch
+    std::vector<I> slot_node;
+    std::vector<I> slot_local;
+    std::vector<unsigned> slot_epoch;
+    unsigned epoch = 0;
+
+    std::vector<I> local_node; //node id of a local id, in the order nodes were touched
+    std::vector<bool> local_settled;
+    Heap heap; //keyed by local ids
+
+    ExplorationState() {}
+
+    inline size_t slot_of(I node) const {
+        uint64_t h = static_cast<uint64_t>(node) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h >> 32) & (slot_node.size() - 1);
+    }
+
+    /*
+     * Return local id of a node, the node is registered if it was not touched in the current run
+     */
+    I touch(I node, bool& inserted) {
+        if (slot_node.size() == 0 || 2 * (local_node.size() + 1) > slot_node.size()) {
+            grow();
+        }
+        size_t slot = slot_of(node);
+        while (slot_epoch[slot] == epoch) {
+            if (slot_node[slot] == node) {
+                inserted = false;
+                return slot_local[slot];
+            }
+            slot = (slot + 1) & (slot_node.size() - 1);
+        }
+        I local = local_node.size();
+        slot_epoch[slot] = epoch;
+        slot_node[slot] = node;
+        slot_local[slot] = local;
+        local_node.push_back(node);
+        local_settled.push_back(false);
+        inserted = true;
+        return local;
+    }
+
+    /*
+     * Double the table and rehash touched nodes of the current run, stale slots are dropped
+     */
+    void grow() {
+        size_t capacity = slot_node.size() == 0 ? INITIAL_CAPACITY : 2 * slot_node.size();
+        slot_node.assign(capacity, 0);
+        slot_local.assign(capacity, 0);
+        slot_epoch.assign(capacity, epoch - 1);
+        for (I local = 0; local < local_node.size(); local++) {
+            size_t slot = slot_of(local_node[local]);
+            while (slot_epoch[slot] == epoch) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            slot_epoch[slot] = epoch;
+            slot_node[slot] = local_node[local];
+            slot_local[slot] = local;
+        }
+    }
+
+    /*
+     * Start a new exploration from the source node
+     */
+    void reset(I source) {
+        epoch++;
+        if (epoch == 0) { //stamps wrapped around, invalidate explicitly
+            std::fill(slot_epoch.begin(), slot_epoch.end(), 0);
+            epoch = 1;
+        }
+        local_node.clear();
+        local_settled.clear();
+        heap.clear();
+        bool inserted;
+        heap.enqueue(touch(source, inserted), 0);
+    }
+
+    /*
+     * A neighbor can be in the heap (update it), settled (ignore) or not touched yet (enqueue)
+     */
+    void relax(I node, W cost) {
+        bool inserted;
+        I local = touch(node, inserted);
+        if (inserted) {
+            heap.enqueue(local, cost);
+        } else if (!local_settled[local] && heap.getVal(local) > cost) {
+            heap.updatequeue(local, cost);
+        }
+    }
+
+    /*
+     * Dequeue the closest node, its distance is final
+     */
+    bool settle(I& node, W& dist) {
+        I local;
+        if (!heap.dequeue(local, dist)) {
+            return false;
+        }
+        local_settled[local] = true;
+        node = local_node[local];
+        return true;
+    }
+
+    inline I size() {
+        return heap.size();
+    }
+
+    inline long touched() const {
+        return local_node.size();
+    }
+};
+
+#endif //FCLA_EXPLORATIONSTATE_H
@@ -8,81 +8,122 @@
 
 #include <vector>
 #include <limits>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 #include "EdgeGenerator.h"
 #include "Network.h"
 #include "nheap.h"
+#include "DaryHeap.h"
+#include "RadixHeap.h"
+#include "ExplorationState.h"
 
-template<typename I, typename W>
+template<typename I, typename W, class Heap = fHeap<W,I>>
 class ExploringEdgeGenerator : public EdgeGenerator {
 public:
     const W INF_W = std::numeric_limits<W>::max();
-    //provide dijkstra in various graph frameworks
-    igraph_t* graph;// do not init or destroy
+    const CSRGraph* csr; //adjacency of the network, do not modify
+    CSRGraph own_csr; //used only if the generator is built from igraph directly
     I node_count_in_network; //note that there is <n> inherited for number of customers
-    std::vector<fHeap<W,I>> dheaps; //dijsktra heaps for each source node
     std::vector<I> source_node_index; //index of customers: source_node_index[id] = vid in graph of a customer #id
-    std::vector<W> weights;
 
     /*
-     * We run <this->n> heap-based dijsktras: if a node was deheaped, the distance is guaranteed to be minimal
-     * for each neighbor : it can be in a heap (so should be updated), or it was deheaped, or it has INF distance
-     * so mark each deheaped node as "visited", but for each dijkstra execution separately
+     * Customers located at the same node share one exploration stream.
+     * We run one heap-based dijsktra per stream: if a node was deheaped, the distance is guaranteed to be minimal
+     * for each neighbor : it can be in a heap (so should be updated), or it was deheaped, or it has INF distance.
+     * Each dijkstra keeps a sparse state, so memory grows with the explored area and not with the network size.
      */
-    std::vector<std::vector<bool>> visited;
+    std::vector<ExplorationState<W,I,Heap>> states; //per stream
+    std::vector<I> stream_of_customer;
+    std::vector<I> stream_source; //node of a stream
+    std::vector<std::vector<I>> stream_customers;
 
-    void updateNeighbor(I customer_id, I target, W cost) {
-        fHeap<W,I>& dheap = dheaps[customer_id];
-        if (dheap.isExisted(target)) {
-            if (dheap.getVal(target) > cost) {
-                dheap.updatequeue(target, cost);
-            }
-        } else {
-            //check if visited
-            if (visited[customer_id][target] == false) {
-                dheap.enqueue(target, cost);
-            } //else ignore neighbor
-        }
-    }
+    /*
+     * Settled targets of a shared stream in increasing distance order, every customer of the stream reads it
+     * with its own cursor. Streams of a single customer do not keep this list.
+     */
+    std::vector<std::vector<std::pair<I,W>>> emitted;
+    std::vector<long> stream_cursor; //per customer
+
+    /*
+     * Prefetch: at reset the first <prefetch_size> edges of every customer are explored in parallel
+     * and stored in per-customer buffers, getEdge drains a buffer before exploring lazily.
+     * Edges are added to edgeMemory when they are handed out, not when they are prefetched.
+     */
+    long prefetch_size = 0;
+    unsigned prefetch_threads = 1;
+    std::vector<std::vector<newEdge>> prefetched;
+    std::vector<long> prefetch_cursor;
 
-    //here we use igraph api
-    void updateNeighbors(I customer_id, I vid, W cur_w) {
-        igraph_vector_t neis;
-        igraph_vector_init(&neis,0);
-        igraph_neighbors(graph, &neis, vid, IGRAPH_ALL); //the graph is undirected (!) - now we work with a road map
-        for (I i = 0; i < igraph_vector_size(&neis); i++) {
-            I neig_vid = VECTOR(neis)[i];
+    inline void updateNeighbor(I stream_id, I target, W cost) {
+        states[stream_id].relax(target, cost);
+    }
 
-            igraph_integer_t eid;
-            igraph_get_eid(graph, &eid, vid, neig_vid, false, true);
-            W new_dist = cur_w + weights[eid];
+    //the graph is undirected (!) - now we work with a road map
+    void updateNeighbors(I stream_id, I vid, W cur_w) {
+        for (const CSRGraph::Arc* arc = csr->begin(vid); arc != csr->end(vid); arc++) {
+            updateNeighbor(stream_id, arc->target, cur_w + arc->weight);
+        }
+    }
 
-            updateNeighbor(customer_id, neig_vid, new_dist);
+    /*
+     * Settle the next nearest node of a stream and relax its neighbors, return false if nothing is left
+     */
+    bool settleNext(I stream_id, I& vid, W& shortest_dist) {
+        if (!states[stream_id].settle(vid, shortest_dist)) {
+            return false;
         }
-        igraph_vector_destroy(&neis);
+        updateNeighbors(stream_id, vid, shortest_dist);
+        return true;
     }
 
-    void init_dijkstra() {
-        visited.clear();
-        dheaps.clear();
-        //n goes for number of customers
+    /*
+     * Group customers by their node, streams are numbered in the order of first customers
+     */
+    void build_streams() {
+        stream_of_customer.resize(n);
+        stream_source.clear();
+        stream_customers.clear();
+        std::unordered_map<I,I> stream_by_node;
         for (I i = 0; i < n; i++) {
-            fHeap<W,I> heap;
-            heap.enqueue(source_node_index[i],0); //first output edge will be a loop edge
-            dheaps.push_back(heap);
+            auto it = stream_by_node.find(source_node_index[i]);
+            if (it == stream_by_node.end()) {
+                it = stream_by_node.insert(std::make_pair(source_node_index[i], (I)stream_source.size())).first;
+                stream_source.push_back(source_node_index[i]);
+                stream_customers.push_back(std::vector<I>());
+            }
+            stream_of_customer[i] = it->second;
+            stream_customers[it->second].push_back(i);
+        }
+    }
 
-            std::vector<bool> v(node_count_in_network, false);
-            visited.push_back(v);
+    inline long stream_count() const {
+        return stream_source.size();
+    }
+
+    inline bool isShared(I stream_id) const {
+        return stream_customers[stream_id].size() > 1;
+    }
+
+    void init_dijkstra() {
+        //states are reused between resets
+        states.resize(stream_count());
+        emitted.resize(stream_count());
+        for (I s = 0; s < stream_count(); s++) {
+            states[s].reset(stream_source[s]); //first output edge will be a loop edge
+            emitted[s].clear();
         }
+        stream_cursor.assign(n, 0);
     }
 
     ExploringEdgeGenerator(Network& network) {
         //init dijkstra heaps
-        node_count_in_network = igraph_vcount(&network.graph);
+        node_count_in_network = network.graph_size();
         this->n = network.source_indexes.size();
         this->m = node_count_in_network;
         this->source_node_index = network.source_indexes;
-        this->graph = &network.graph;
-        this->weights = network.weights;
+        this->csr = &network.csr;
+        build_streams();
         init_dijkstra();
     }
 
@@ -95,18 +136,151 @@ public:
                            std::vector<I>& source_node_index)
     {
         //init dijkstra heaps
-        node_count_in_network = igraph_vcount(g);
+        own_csr.build(g, weights);
+        node_count_in_network = own_csr.node_count();
         this->n = source_node_index.size();
-        this->m = igraph_vcount(g);
+        this->m = node_count_in_network;
         this->source_node_index = source_node_index;
-        this->graph = g;
-        this->weights = weights;
+        this->csr = &own_csr;
+        build_streams();
         init_dijkstra();
     }
     ~ExploringEdgeGenerator() {}
 
+    void setPrefetch(long prefetch_size, unsigned prefetch_threads) {
+        this->prefetch_size = prefetch_size;
+        this->prefetch_threads = std::max(prefetch_threads, 1u);
+    }
+
+    /*
+     * Settle the next node of a stream that is returned as an edge, every node by default
+     */
+    virtual bool settleNextTarget(I stream_id, I& vid, W& shortest_dist) {
+        return settleNext(stream_id, vid, shortest_dist);
+    }
+
+    //for target node we must return ID of a facility, i.e.
+    virtual long getTargetNode(I vid) {
+        return this->n + vid;
+    }
+
+    /*
+     * Next target of a customer from its stream, a shared stream is advanced only by the customer
+     * that reads beyond its end
+     */
+    bool streamNext(I customer_id, I& vid, W& shortest_dist) {
+        I stream_id = stream_of_customer[customer_id];
+        if (!isShared(stream_id)) {
+            return settleNextTarget(stream_id, vid, shortest_dist);
+        }
+        std::vector<std::pair<I,W>>& stream = emitted[stream_id];
+        if (stream_cursor[customer_id] == stream.size()) {
+            if (!settleNextTarget(stream_id, vid, shortest_dist)) {
+                return false;
+            }
+            stream.push_back(std::make_pair(vid, shortest_dist));
+        }
+        vid = stream[stream_cursor[customer_id]].first;
+        shortest_dist = stream[stream_cursor[customer_id]].second;
+        stream_cursor[customer_id]++;
+        return true;
+    }
+
+    /*
+     * Explore the next edge of a customer without buffering, return false if nothing is left.
+     * Touches only the stream of this customer, so different streams can be explored concurrently.
+     */
+    bool exploreNext(I customer_id, newEdge& e) {
+        I next_vid;
+        W shortest_dist;
+        if (!streamNext(customer_id, next_vid, shortest_dist)) {
+            return false;
+        }
+        /*
+         * Capacity of each edge must NOT be equal to facility capacity, but must be equal to ONE
+         * (in a bipartite graph) that means exactly that each service can be matched with
+         * one customer only ONCE, and at the same time it can be matched with several
+         * customers according to its capacity.
+         */
+        e.exists = true;
+        e.capacity = 1; //THIS IS IMPORTANT(!)
+        e.source_node = customer_id;
+        e.target_node = getTargetNode(next_vid);
+        e.weight = shortest_dist; //shortest distance between
+        return true;
+    }
+
+    void prefetchCustomer(I customer_id) {
+        std::vector<newEdge>& customer_buffer = prefetched[customer_id];
+        newEdge e;
+        while (customer_buffer.size() < prefetch_size && exploreNext(customer_id, e)) {
+            customer_buffer.push_back(e);
+        }
+    }
+
+    /*
+     * Fill buffers of all customers. Streams are distributed between threads in small chunks
+     * because explorations differ a lot in cost, customers of a stream are filled by one thread.
+     */
+    void prefetch() {
+        prefetched.resize(n);
+        prefetch_cursor.assign(n, 0);
+        for (I i = 0; i < n; i++) {
+            prefetched[i].clear();
+        }
+        if (prefetch_size <= 0) {
+            return;
+        }
+        if (prefetch_threads <= 1 || stream_count() < 2) {
+            for (I s = 0; s < stream_count(); s++) {
+                prefetchStream(s);
+            }
+            return;
+        }
+        const long chunk = 16;
+        std::atomic<long> next_stream(0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < prefetch_threads; t++) {
+            workers.push_back(std::thread([this, &next_stream, chunk]() {
+                long first;
+                while ((first = next_stream.fetch_add(chunk)) < this->stream_count()) {
+                    long last = std::min(first + chunk, this->stream_count());
+                    for (long s = first; s < last; s++) {
+                        this->prefetchStream(s);
+                    }
+                }
+            }));
+        }
+        for (long t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    void prefetchStream(I stream_id) {
+        for (long i = 0; i < stream_customers[stream_id].size(); i++) {
+            prefetchCustomer(stream_customers[stream_id][i]);
+        }
+    }
+
+    inline bool hasPrefetched(long vid) {
+        return vid < prefetched.size() && prefetch_cursor[vid] < prefetched[vid].size();
+    }
+
+    /*
+     * Next edge of a customer, from the buffer if it is not drained
+     */
+    bool nextEdge(I customer_id, newEdge& e) {
+        if (hasPrefetched(customer_id)) {
+            e = prefetched[customer_id][prefetch_cursor[customer_id]++];
+            return true;
+        }
+        return exploreNext(customer_id, e);
+    }
+
     bool isComplete(long vid) override {
-        return dheaps[vid].size() == 0;
+        I stream_id = stream_of_customer[vid];
+        return !hasPrefetched(vid) && states[stream_id].size() == 0 &&
+               (!isShared(stream_id) || stream_cursor[vid] == emitted[stream_id].size());
     }
 
     //get next neighbor of a customer with ID = vid. Corresponding node in the graph = source_node_index[vid]
@@ -115,32 +289,18 @@ public:
         if ((vid >= this->n) || (isComplete(vid))) {
             e.exists = false;
         } else {
-            e.exists = true;
-            I next_vid;
-            W shortest_dist;
-            dheaps[vid].dequeue(next_vid, shortest_dist);
-            visited[vid][next_vid] = true;
-            updateNeighbors(vid, next_vid, shortest_dist);
-            /*
-             * Capacity of each edge must NOT be equal to facility capacity, but must be equal to ONE
-             * (in a bipartite graph) that means exactly that each service can be matched with
-             * one customer only ONCE, and at the same time it can be matched with several
-             * customers according to its capacity.
-             */
-            e.capacity = 1; //THIS IS IMPORTANT(!)
-            e.source_node = vid;
-            //for target node we must return ID of a facility, i.e.
-            e.target_node = this->n + next_vid;
-            e.weight = shortest_dist; //shortest distance between
+            nextEdge(vid, e);
             edgeMemory.push_back(e);
         }
 
         return e;
     }
 
-    //this should reset edge memory
+    //edge memory is a prefix of the current exploration, so it starts anew
     void reset() override {
+        edgeMemory.clear();
         init_dijkstra();
+        prefetch();
     }
 };
 
@@ -11,17 +11,18 @@
 #ifndef FCLA_FACILITYCHOOSER_H
 #define FCLA_FACILITYCHOOSER_H
 
-#include <forward_list>
 #include <fstream>
 #include <stack>
 #include "nheap.h"
 #include "ExploringEdgeGenerator.h"
 #include "TargetExploringEdgeGenerator.h"
+#include "TargetEdgeGenerator.h"
+#include "CHEdgeGenerator.h"
 #include "Matcher.h"
 #include "Network.h"
 #include "Logger.h"
 #include "helpers.h"
-#include "FacilityRank.h"
+#include "SetCover.h"
 #include "exceptions.h"
 
 class FacilityChooser : public Matcher<long,long,long> {
@@ -41,9 +42,8 @@ public:
     std::vector<long> target_capacities;
     State state = UNINITIALIZED;
     std::vector<long> customer_antirank; //number of facilities a customer is
-    std::vector<long> last_used;
     double alpha;
-    long capacity_iteration;//iteration ID for WMA, utilized in last_used for potential facilities
+    long capacity_iteration;//iteration ID for WMA
     long total_covered;
 
     bool uniform_capacities;
@@ -52,6 +52,13 @@ public:
 
     int objective_matching = 1; //if objective is calculated as SIA
 
+    //nearest facilities explored in parallel per customer before matching, 0 - lazy exploration only
+    long prefetch_size = 0;
+    unsigned prefetch_threads = 1;
+    bool use_ch = false; //distances by contraction hierarchy instead of exploration
+    std::vector<long> facility_reverse_index; //node id -> facility id, if not all nodes are available
+    SetCover<long,long> set_cover; //kept between capacity iterations
+
     /*
      * lambda is a parameter that states when to terminate the heap exploration
      * it is equal to a minimal service filling required for considering that service
@@ -64,15 +71,12 @@ public:
      * Check feasibility by number of components
      */
     void check_feasibility() {
-        igraph_t* g = &(network->graph);
-        igraph_integer_t components;
-        igraph_vector_t membership;
-        igraph_vector_init(&membership,0);
-        igraph_clusters(g, &membership, 0, &components, IGRAPH_WEAK);
+        long components = network->components();
+        std::vector<long>& membership = network->component_membership;
         logger->add("number of components", components);
         std::vector<long> customers_sum(components,0);
         for (long i = 0; i < this->source_count; i++) {
-            customers_sum[VECTOR(membership)[this->source_indexes[i]]]++;
+            customers_sum[membership[this->source_indexes[i]]]++;
         }
         //todo nonequal capacities
         long total_facilities = 0;
@@ -80,7 +84,6 @@ public:
             total_facilities += ceil((double) customers_sum[i] / (double) this->facility_capacity);
         }
 
-        igraph_vector_destroy(&membership);
         if (total_facilities > this->required_facilities) {
             throw infeasible_solution;
         }
@@ -134,10 +137,15 @@ public:
             this->edge_generator = new TargetExploringEdgeGenerator<long, long>(network, network.target_indexes);
         }
         graph_size = edge_generator->n + edge_generator->m + 1;
-        this->last_used.resize(edge_generator->m, -1);
         this->customer_antirank.clear();
         this->customer_antirank.resize(source_count);
         this->build_source_reverse_index();
+        if (!this->all_nodes_available) {
+            this->facility_reverse_index.assign(network.graph_size(), -1);
+            for (long i = 0; i < this->target_indexes.size(); i++) {
+                this->facility_reverse_index[this->target_indexes[i]] = i;
+            }
+        }
 
         logger->add("bipartite graph size", graph_size);
 
@@ -153,6 +161,49 @@ public:
         delete this->edge_generator;
     }
 
+    /*
+     * Explore first <prefetch_size> facilities of every customer with <prefetch_threads> threads,
+     * applies both to the set cover phase and to the final matching
+     */
+    void setPrefetch(long prefetch_size, unsigned prefetch_threads) {
+        this->prefetch_size = prefetch_size;
+        this->prefetch_threads = prefetch_threads;
+        ExploringEdgeGenerator<long,long>* exploring = dynamic_cast<ExploringEdgeGenerator<long,long>*>(this->edge_generator);
+        if (exploring != NULL) { //contraction hierarchy does not explore
+            exploring->setPrefetch(prefetch_size, prefetch_threads);
+            reset();
+        }
+    }
+
+    /*
+     * Obtain customer-facility distances from a contraction hierarchy of the network (built once per network)
+     */
+    void setContractionHierarchy(bool use_ch) {
+        if (this->use_ch == use_ch) {
+            return;
+        }
+        this->use_ch = use_ch;
+        delete this->edge_generator;
+        if (use_ch) {
+            std::vector<long> facility_nodes = this->target_indexes;
+            if (this->all_nodes_available) {
+                facility_nodes.resize(this->network->graph_size());
+                for (long i = 0; i < facility_nodes.size(); i++) {
+                    facility_nodes[i] = i;
+                }
+            }
+            this->edge_generator = new CHEdgeGenerator<long, long>(*this->network, facility_nodes);
+        } else if (this->all_nodes_available) {
+            this->edge_generator = new ExploringEdgeGenerator<long, long>(*this->network);
+        } else {
+            this->edge_generator = new TargetExploringEdgeGenerator<long, long>(*this->network, this->target_indexes);
+        }
+        reset();
+        if (!use_ch) {
+            setPrefetch(this->prefetch_size, this->prefetch_threads);
+        }
+    }
+
     std::vector<long> get_node_excess() {
         std::vector<long> node_excess(this->graph_size, -1);
         if (this->uniform_capacities || this->partially_uniform) {
@@ -199,20 +250,18 @@ public:
     bool findSetCover() {
         logger->start("set cover check time");
         std::fill(customer_antirank.begin(), customer_antirank.end(), 0);
-        //initialize single linked lists and heaps
         this->result.clear();
-        fHeap<FacilityRank,long> heap;
-        std::vector<std::forward_list<long>> matching;
-        heap.sign = 1; //make heap decreasing order
-        this->fillQueueOfMatchedNodesPerFacility(matching, heap);
-        if (heap.size() == 0) {
+        //only facilities with changed matching are refreshed
+        long refreshed = this->set_cover.update(this->edges, source_count, source_count, this->get_facility_count()-1);
+        logger->add2("set cover refreshed facilities", refreshed);
+        if (this->get_facility_count()-1 == 0) {
             return false; //out of available facilities for some reason (probably border case)
         }
 
-        std::vector<long> covered(this->source_count, 0);
-	    this->max_coverage = heap.getTopValue().coverage;
-        bool if_result = greedySetCover(matching, covered, heap);
-        this->updateCustomerAntirank(covered);
+        bool if_result = this->set_cover.run(this->required_facilities + lambda, this->result);
+        this->total_covered = this->set_cover.total_covered;
+        this->max_coverage = this->set_cover.max_coverage;
+        this->updateCustomerAntirank(this->set_cover.covered);
         logger->add2("total covered final", total_covered);
 
         logger->finish("set cover check time");
@@ -225,118 +274,6 @@ public:
         }
     }
 
-    /*
-     * Rank facilities according to matched nodes and the last iteration when it was used
-     */
-     void fillQueueOfMatchedNodesPerFacility(std::vector<std::forward_list<long>>& matching, fHeap<FacilityRank,long>& heap) {
-        matching.resize(this->get_facility_count()-1);//without extra node
-        for (long i = source_count; i < graph_size-1; i++) {
-            forward_list<long> linked_nodes;
-            long target_id = this->get_target_id_by_bi_node_id(i);
-            //there can be many matched vertices because of capacities
-            long matching_count = 0;
-            EdgeIterator it;
-            for (it = edges[i].begin(); it != edges[i].end(); it++) {
-                linked_nodes.push_front(it->first);
-                matching_count++;
-            }
-            //put in a heap
-            if (matching_count >= 0) {
-                heap.enqueue(i, FacilityRank(matching_count,this->last_used[target_id]));
-            }
-            matching[target_id] = linked_nodes;
-        }
-    };
-
-
-    bool greedySetCover(std::vector<std::forward_list<long>>& matching, std::vector<long>& local_covered, fHeap<FacilityRank,long>& heap) {
-        long heap_iterations = 0;
-        total_covered = 0;
-        while (pickAnotherFacility(matching, local_covered, heap)) {
-            heap_iterations++;
-        }
-//        std::cout << total_covered << std::endl;
-//        logger->add2("greedy deheap iterations", heap_iterations);
-        return (total_covered == source_count);
-    }
-
-    bool pickAnotherFacility(std::vector<std::forward_list<long>>& matching, std::vector<long>& local_covered, fHeap<FacilityRank,long>& heap) {
-        if (heap.size() == 0) {
-            return false;
-        }
-
-        long bi_node_id;
-        FacilityRank rank(-1,-1);
-        heap.dequeue(bi_node_id, rank);
-        long init_target_coverage = rank.coverage;
-        long target_id = this->get_target_id_by_bi_node_id(bi_node_id);
-
-        //test if matching is not empty. If so - return false immediately
-        if (matching[target_id].begin() == matching[target_id].end()) {
-            return false;
-        }
-        // check which matched vertex is still not covered and delete covered ones
-        long new_covered_by_target_count = this->remove_covered_customers_from_queue(matching[target_id], local_covered);
-
-        if (new_covered_by_target_count != init_target_coverage) {
-            //if the size was changed - enheap back
-            //not guaranteed to have a non-decreasing matching count
-            rank.coverage = new_covered_by_target_count;
-            heap.enqueue(bi_node_id, rank);
-            return true;
-        } else {
-            // otherwise add to the result and update coverage
-            result.push_back(target_id);
-
-            double relative_gain = (double) new_covered_by_target_count / (double) (source_count - total_covered);
-//            logger->add2("relative gain", relative_gain);
-//            logger->add2("matching count", new_covered_by_target_count);
-//            logger->add2("left count", source_count - total_covered);
-
-            if (result.size() > this->required_facilities + lambda) {
-                return false;
-            }
-            //update usage history here
-            this->last_used[target_id] = this->capacity_iteration;
-
-            for (auto it = matching[target_id].begin(); it != matching[target_id].end(); it++) {
-                //every node in single-linked list must not be covered yet
-                local_covered[(*it)]++;
-                total_covered++;
-            }
-            return true;
-        }
-    }
-
-    long remove_covered_customers_from_queue(std::forward_list<long>& queue, std::vector<long>& coverage) {
-        // linked list can delete only the NEXT element, so we are checking each next element,
-        // and then the first one separately
-        long non_covered_count = 0;
-        auto it = queue.begin();
-        auto prev_it = queue.begin();
-        it++;
-        while (it != queue.end()) {
-            long pair_id = (*it);
-            if (coverage[pair_id]) {
-                //delete from a linked-list
-                queue.erase_after(prev_it);
-                it = prev_it;
-            } else {
-                non_covered_count++;
-                prev_it = it;
-            }
-            it++;
-        }
-        //process the first one
-        long first_node = (*queue.begin());
-        if (coverage[first_node]) {
-            queue.pop_front();
-        } else {
-            non_covered_count++;
-        }
-        return non_covered_count;
-    }
-
     /*
      * return: true if at least one customer is newly matched
      */
@@ -372,7 +309,8 @@ public:
 //            }
 //        }
 
-        if (this->greedyMatching) {
+        bool incremental = this->greedyMatching && this->canMatchGreedyIncrementally();
+        if (this->greedyMatching && !incremental) {
             this->resetAssignmentForGreedyMatching();
         }
 
@@ -391,7 +329,8 @@ public:
         }
 
         if (this->greedyMatching) {
-            std::vector<long> newly_explored_sources = this->matchGreedy();
+            std::vector<long> newly_explored_sources = incremental ? this->matchGreedyIncrement()
+                                                                         : this->matchGreedy();
             anychanges = (newly_explored_sources.size() < total_increased);
             for (auto it = newly_explored_sources.begin(); it != newly_explored_sources.end(); it++) {
                 complete_sources[(*it)] = 1;
@@ -404,9 +343,10 @@ public:
     void resetAssignmentForGreedyMatching() {
         for (auto i = 0; i < this->edge_generator->n; i++) {
             this->node_excess[i] = this->full_node_excess[i];
+            this->greedy_cursor[i] = 0;
         }
         for (auto i = this->edge_generator->n; i < this->edges.size(); i++) {
-            this->edges[i] = Adjlist();
+            this->edges[i].clear();
             this->node_excess[i] = this->full_node_excess[i];
         }
     }
@@ -532,7 +472,7 @@ public:
     }
 
     inline long get_facility_id_by_node_id(long node_id) {
-        return (this->all_nodes_available) ? node_id : dynamic_cast<TargetExploringEdgeGenerator<long,long>*>(this->edge_generator)->get_facility_id_by_node_id(node_id);
+        return (this->all_nodes_available) ? node_id : this->facility_reverse_index[node_id];
     }
 
     inline long get_source_id_by_node_id(long node_id) {
@@ -574,7 +514,8 @@ public:
         //on the right side of bipartite graph
 
         //build valid bipartite graph : reverse all edges to the direct position
-        //create an edge generator with calculated distances between known facilities and customers
+        //create an edge generator with calculated distances between known facilities and customers:
+        //distances memorized while locating are replayed, exploration resumes where they run out
         //run new matcher
 
         std::string facility_index_list = "";
@@ -589,9 +530,21 @@ public:
         for (long i = 0; i < this->source_indexes.size(); i++) {
             new_excess[i] = -1;
         }
-        std::vector<long> chosen_node_ids = this->get_chosen_facility_node_ids();
-        TargetExploringEdgeGenerator<long, long> bigraph_generator(*this->network, chosen_node_ids);
-        Matcher<long,long,long> M(&bigraph_generator, new_excess, this->logger, false);
+        EdgeGenerator* bigraph_generator;
+        if (this->use_ch) {
+            //bucket queries to the chosen facilities only are cheaper than resuming the hierarchy of all facilities
+            std::vector<long> chosen_node_ids = this->get_chosen_facility_node_ids();
+            bigraph_generator = make_target_edge_generator(*this->network, chosen_node_ids, true);
+        } else {
+            TargetEdgeGenerator* replaying_generator = new TargetEdgeGenerator(this, this->result);
+            long replayed_edges = 0;
+            for (long i = 0; i < replaying_generator->edgeQueue.size(); i++) {
+                replayed_edges += replaying_generator->edgeQueue[i].size();
+            }
+            logger->add1("replayed edges", replayed_edges);
+            bigraph_generator = replaying_generator;
+        }
+        Matcher<long,long,long> M(bigraph_generator, new_excess, this->logger, false);
         M.greedyMatching = this->greedyMatching * this->objective_matching; //objective matching 0 means there should be SIA for objective calculation
         M.greedyMatchingOrder = this->greedyMatchingOrder;
         M.network = this->network;
@@ -605,6 +558,7 @@ public:
             capn += (M.node_excess[i] == 0);
         }
         logger->add1("full facilities", capn);
+        delete bigraph_generator;
 
         logger->finish("result final calculation time");
         logger->add("objective", totalCost);
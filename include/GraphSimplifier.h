@@ -0,0 +1,131 @@
+/*
+ * Contraction of degree-2 chains of a road network.
+ *
+ * Networks made of OSM ways have most of their nodes in the middle of roads, with exactly two neighbors. Such a
+ * node is removed unless it is a customer or a potential facility: every chain of removed nodes between two kept
+ * ones becomes one edge of the summed weight, so distances between kept nodes do not change. Chains that return to
+ * their start are dropped, as well as cycles that consist of removed nodes only, and of parallel chains only the
+ * shortest one is kept.
+ *
+ * Node i of the simplified network is node_ids[i] of the original one, facilities found on the simplified network
+ * are reported in original ids by restore_ids().
+ */
+
+#ifndef FCLA_GRAPHSIMPLIFIER_H
+#define FCLA_GRAPHSIMPLIFIER_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include "Network.h"
+#include "Logger.h"
+
+class GraphSimplifier {
+public:
+    Network* simplified;
+    std::vector<long> node_ids; //simplified node -> original node
+    std::vector<long> new_id; //original node -> simplified node, -1 if removed
+
+    GraphSimplifier(Network& network) {
+        const CSRGraph& csr = network.csr;
+        long n = network.graph_size();
+        std::vector<bool> terminal(n, false);
+        for (long i = 0; i < network.source_indexes.size(); i++) {
+            terminal[network.source_indexes[i]] = true;
+        }
+        for (long i = 0; i < network.target_indexes.size(); i++) {
+            terminal[network.target_indexes[i]] = true;
+        }
+        new_id.assign(n, -1);
+        for (long v = 0; v < n; v++) {
+            if (terminal[v] || !is_chain_node(csr, v)) {
+                new_id[v] = node_ids.size();
+                node_ids.push_back(v);
+            }
+        }
+
+        simplified = new Network();
+        simplified->id = network.id;
+        //every chain is walked from both of its ends and added from the one with the smaller id
+        std::vector<std::pair<std::pair<long,long>,long>> chains; //ends, weight
+        for (long k = 0; k < node_ids.size(); k++) {
+            long u = node_ids[k];
+            for (const CSRGraph::Arc* arc = csr.begin(u); arc != csr.end(u); arc++) {
+                long prev = u;
+                long v = arc->target;
+                long weight = arc->weight;
+                while (new_id[v] == -1) {
+                    const CSRGraph::Arc* next = csr.begin(v);
+                    if (next->target == prev) {
+                        next++;
+                    }
+                    prev = v;
+                    v = next->target;
+                    weight += next->weight;
+                }
+                if (u < v) {
+                    chains.push_back(std::make_pair(std::make_pair(new_id[u], new_id[v]), weight));
+                }
+            }
+        }
+        //networks have no multiple edges, of parallel chains only the shortest is kept
+        std::sort(chains.begin(), chains.end());
+        for (long i = 0; i < chains.size(); i++) {
+            if (i > 0 && chains[i].first == chains[i - 1].first) {
+                continue;
+            }
+            simplified->edges.push_back(chains[i].first.first);
+            simplified->edges.push_back(chains[i].first.second);
+            simplified->weights.push_back(chains[i].second);
+        }
+        simplified->csr.build(node_ids.size(), simplified->edges, simplified->weights);
+
+        for (long i = 0; i < network.source_indexes.size(); i++) {
+            simplified->source_indexes.push_back(new_id[network.source_indexes[i]]);
+        }
+        for (long i = 0; i < network.target_indexes.size(); i++) {
+            simplified->target_indexes.push_back(new_id[network.target_indexes[i]]);
+        }
+        simplified->target_capacities = network.target_capacities;
+        if (network.coords.size() == n) {
+            for (long i = 0; i < node_ids.size(); i++) {
+                simplified->coords.push_back(network.coords[node_ids[i]]);
+            }
+        }
+    }
+    ~GraphSimplifier() {
+        delete simplified;
+    }
+
+    /*
+     * Exactly two arcs, none of them a loop
+     */
+    static bool is_chain_node(const CSRGraph& csr, long v) {
+        if (csr.end(v) - csr.begin(v) != 2) {
+            return false;
+        }
+        return csr.begin(v)->target != v && (csr.begin(v) + 1)->target != v;
+    }
+
+    /*
+     * Rewrite node ids of located facilities in the log to ids of the original network
+     */
+    void restore_ids(Logger* logger) {
+        if (logger->str_dict.count("facilities_indexes") == 0) {
+            return;
+        }
+        std::vector<std::string>& lists = logger->str_dict["facilities_indexes"];
+        for (long k = 0; k < lists.size(); k++) {
+            std::istringstream in(lists[k]);
+            std::string restored = "";
+            std::string node;
+            while (std::getline(in, node, ',')) {
+                restored += std::to_string(node_ids[std::stol(node)]) + ",";
+            }
+            lists[k] = restored;
+        }
+    }
+};
+
+#endif //FCLA_GRAPHSIMPLIFIER_H
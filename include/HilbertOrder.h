@@ -0,0 +1,86 @@
+/*
+ * Spatial order of points along a Hilbert curve.
+ *
+ * Coordinates are quantized once to BITS bits per axis within the bounding box of the points, and every point
+ * gets a 64-bit curve index by hilbert_c2i. Items are then ordered by a stable LSD radix sort of their keys
+ * instead of comparing coordinates pairwise.
+ */
+
+#ifndef FCLA_HILBERTORDER_H
+#define FCLA_HILBERTORDER_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "Hilbert.h"
+
+class HilbertOrder {
+public:
+    static const unsigned BITS = 32; //per axis, a key has 2*BITS bits
+    static const unsigned DIGIT_BITS = 8; //per radix sort pass
+
+    /*
+     * Curve index of each point, points are quantized in their common bounding box
+     */
+    static std::vector<uint64_t> keys(const std::vector<std::pair<double,double>>& points) {
+        std::vector<uint64_t> result(points.size());
+        if (points.size() == 0) {
+            return result;
+        }
+        double min_x = points[0].first, max_x = points[0].first;
+        double min_y = points[0].second, max_y = points[0].second;
+        for (long i = 1; i < points.size(); i++) {
+            min_x = std::min(min_x, points[i].first);
+            max_x = std::max(max_x, points[i].first);
+            min_y = std::min(min_y, points[i].second);
+            max_y = std::max(max_y, points[i].second);
+        }
+        double cells = (double) (((uint64_t) 1 << BITS) - 1);
+        double scale_x = max_x > min_x ? cells / (max_x - min_x) : 0;
+        double scale_y = max_y > min_y ? cells / (max_y - min_y) : 0;
+        bitmask_t coord[2];
+        for (long i = 0; i < points.size(); i++) {
+            coord[0] = (bitmask_t) ((points[i].first - min_x) * scale_x);
+            coord[1] = (bitmask_t) ((points[i].second - min_y) * scale_y);
+            result[i] = hilbert_c2i(2, BITS, coord);
+        }
+        return result;
+    }
+
+    /*
+     * Stable sort of items by their keys (keys[i] belongs to items[i]), passes over digits
+     * that are equal in all keys are skipped
+     */
+    template<class T>
+    static void sort(std::vector<T>& items, std::vector<uint64_t>& item_keys) {
+        const uint64_t digits = (uint64_t) 1 << DIGIT_BITS;
+        std::vector<T> items_buffer(items.size());
+        std::vector<uint64_t> keys_buffer(item_keys.size());
+        std::vector<long> offsets(digits);
+        for (unsigned shift = 0; shift < 64; shift += DIGIT_BITS) {
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (long i = 0; i < item_keys.size(); i++) {
+                offsets[(item_keys[i] >> shift) & (digits - 1)]++;
+            }
+            if (item_keys.size() == 0 || offsets[(item_keys[0] >> shift) & (digits - 1)] == item_keys.size()) {
+                continue;
+            }
+            long position = 0;
+            for (uint64_t d = 0; d < digits; d++) {
+                long count = offsets[d];
+                offsets[d] = position;
+                position += count;
+            }
+            for (long i = 0; i < item_keys.size(); i++) {
+                long target = offsets[(item_keys[i] >> shift) & (digits - 1)]++;
+                items_buffer[target] = items[i];
+                keys_buffer[target] = item_keys[i];
+            }
+            items.swap(items_buffer);
+            item_keys.swap(keys_buffer);
+        }
+    }
+};
+
+#endif //FCLA_HILBERTORDER_H
@@ -15,8 +15,10 @@
 #include "FacilityChooser.h"
 #include "igraph/igraph.h"
 #include "Logger.h"
-#include "Hilbert.h"
+#include "HilbertOrder.h"
+#include "SpatialIndex.h"
 #include "TargetExploringEdgeGenerator.h"
+#include "CHEdgeGenerator.h"
 #include "exceptions.h"
 
 class HilbertSolver {
@@ -26,6 +28,7 @@ public:
     Network* network;
     long facility_number_to_locate;
     long facility_capacity;
+    bool use_ch = false; //distances by contraction hierarchy instead of exploration
 
     HilbertSolver(Network* net, Logger* logger) {
         this->network = net;
@@ -41,19 +44,6 @@ public:
         long index;
     };
 
-    struct ComparatorHilbertEntry
-    {
-        bool operator()(const Customer& r1, const Customer& r2)
-        {
-            double d1[2],d2[2];
-            d1[0] = r1.coords.first;
-            d1[1] = r1.coords.second;
-            d2[0] = r2.coords.first;
-            d2[1] = r2.coords.second;
-            return hilbert_ieee_cmp(2,d1,d2) >= 0;
-        }
-    } hilbert_comparator;
-
     inline double get_dist(Coords& c1, Coords& c2)
     {
         return sqrt(pow(c1.first-c2.first,2) + pow(c1.second-c2.second,2));
@@ -78,52 +68,41 @@ public:
         return result;
     }
 
-    std::vector<long> get_facility_node_indexes_in_component(std::vector<Customer>& customers, std::vector<long> potential_facility_node_indexes, long facility_count) {
+    std::vector<long> get_facility_node_indexes_in_component(std::vector<Customer>& customers, const std::vector<long>& potential_facility_node_indexes, long facility_count) {
         /*
          * Return locations of new facilities in the connected component of the graph.
          *
          * Splits customers into k buckets, where k = number of facilities
          * Calculate geocenter for each bucket and return closest node to the geocenter
          *
-         * component_node_indexes is copied since modified inside the function
+         * Potential facilities are indexed by a KD-tree, a node is removed from it once selected
          */
 
         std::vector<long> facility_locations;
         if (customers.size() == 0 || facility_count == 0) return facility_locations;
 
-        std::sort(customers.begin(), customers.end(), hilbert_comparator);
+        const std::vector<uint64_t>& node_keys = network->get_hilbert_keys();
+        std::vector<uint64_t> keys(customers.size());
+        for (long i = 0; i < customers.size(); i++) {
+            keys[i] = node_keys[customers[i].index];
+        }
+        HilbertOrder::sort(customers, keys);
 
+        SpatialIndex candidates(network->coords, potential_facility_node_indexes);
         std::vector<long> splitting_indexes = equally_splitting_indexes(customers.size(), facility_count);
         for (long i = 0; i < facility_count; i++) {
             if (splitting_indexes[i+1] == splitting_indexes[i]) continue;
             Coords center = geocenter(customers, splitting_indexes[i], splitting_indexes[i+1]);
-            if (potential_facility_node_indexes.size() == 0) {
+            if (candidates.size() == 0) {
                 throw std::string("Not enough potential facility locations");
             }
-            long node_index = return_and_remove_closest_node_index(potential_facility_node_indexes, center); //side effect
-            facility_locations.push_back(node_index);
+            long best = candidates.nearest(center);
+            candidates.remove(best); // prevent the node from being selected again
+            facility_locations.push_back(potential_facility_node_indexes[best]);
         }
         return facility_locations;
     }
 
-    long return_and_remove_closest_node_index(std::vector<long>& node_indexes, Coords center) {
-        /*
-         * Find best candidate by linear search.
-         */
-        long best_index = -1;
-        double best_dist = INFINITY;
-        for (long i = 0; i < node_indexes.size(); i++) {
-            double dist = get_dist(center, network->coords[node_indexes[i]]);
-            if (dist < best_dist) {
-                best_dist = dist;
-                best_index = i;
-            }
-        }
-        long best_node_index = node_indexes[best_index];
-        node_indexes.erase(node_indexes.begin() + best_index); // prevent the node from being selected again
-        return best_node_index;
-    }
-
     Coords geocenter(std::vector<Customer>& customers, long start_index, long end_index)
     {
         assert(end_index > start_index);
@@ -187,13 +166,9 @@ public:
 
     std::vector<long> get_facility_node_indexes(long facility_number_to_locate)
     {
-        igraph_integer_t components;
-        igraph_vector_t membership;
-        igraph_vector_t csize;
-        igraph_vector_init(&membership,0);
-        igraph_vector_init(&csize,0);
         logger->start("compute components");
-        igraph_clusters(&(network->graph), &membership, &csize, &components, IGRAPH_WEAK);
+        long components = network->components();
+        std::vector<long>& membership = network->component_membership;
         logger->finish("compute components");
         logger->add("number of components", components);
 
@@ -202,7 +177,7 @@ public:
         for (long component_id = 0; component_id < components; component_id++) {
             std::vector<Customer> customers;
             for (long i = 0; i < network->source_indexes.size(); i++) {
-                if (VECTOR(membership)[network->source_indexes[i]] == component_id) {
+                if (membership[network->source_indexes[i]] == component_id) {
                     Customer new_customer;
                     new_customer.coords.first = network->coords[network->source_indexes[i]].first;
                     new_customer.coords.second = network->coords[network->source_indexes[i]].second;
@@ -214,14 +189,12 @@ public:
 
             std::vector<long> component_node_indexes;
             for (long i = 0; i < network->graph_size(); i++) {
-                if (VECTOR(membership)[i] == component_id) {
+                if (membership[i] == component_id) {
                     component_node_indexes.push_back(i);
                 }
             }
             node_indexes_per_component.push_back(component_node_indexes);
         }
-        igraph_vector_destroy(&membership);
-        igraph_vector_destroy(&csize);
 
         // run solver per each component independently
         std::vector<long> result;
@@ -271,10 +244,11 @@ public:
             }
         }
 
-        TargetExploringEdgeGenerator<long,long> edge_generator(*network, only_target_facility_node_indexes);
-        Matcher<long,long,long> M(&edge_generator, new_excess, logger);
+        EdgeGenerator* edge_generator = make_target_edge_generator(*network, only_target_facility_node_indexes, use_ch);
+        Matcher<long,long,long> M(edge_generator, new_excess, logger);
         M.match();
         M.calculateResult();
+        delete edge_generator;
         return M.result_weight;
     }
 
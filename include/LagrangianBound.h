@@ -0,0 +1,215 @@
+/*
+ * Lower bound of the capacitated facility location by Lagrangian relaxation of the assignment constraints.
+ *
+ * With a multiplier lambda_i per customer the relaxed problem splits by facilities: facility j would serve the at
+ * most capacity_j customers with the most negative reduced costs d_ij - lambda_i, and the k facilities of the
+ * smallest totals are opened. L(lambda) = sum lambda_i + sum of these totals is a lower bound for any lambda,
+ * multipliers are improved by subgradient steps towards the objective of a known solution.
+ *
+ * Distances are taken only to the nearest facilities of every customer (from an EdgeGenerator). Facilities that
+ * are not in the list of customer i are not closer than its last one D_i, so as long as lambda_i <= D_i their
+ * reduced costs are not negative and L(lambda) over the lists equals L(lambda) over all facilities.
+ */
+
+#ifndef FCLA_LAGRANGIANBOUND_H
+#define FCLA_LAGRANGIANBOUND_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include "EdgeGenerator.h"
+#include "CHEdgeGenerator.h"
+#include "Network.h"
+#include "Logger.h"
+
+class LagrangianBound {
+public:
+    long max_iterations = 500;
+    double initial_step = 2; //scale of the subgradient step, halved when the bound stalls
+    double min_step = 1e-4;
+    long patience = 20; //iterations without improvement before the step is halved
+
+    long n; //customers
+    long m; //facilities
+    long facilities_to_locate;
+    std::vector<long> capacities;
+    bool feasible = true; //false if some customer has no facility at all
+
+    //candidate facilities of customer i are in [customer_offsets[i], customer_offsets[i+1]) of customer_entries
+    std::vector<long> customer_offsets;
+    std::vector<std::pair<long,long>> customer_entries; //facility id, distance
+    std::vector<double> max_lambda; //distance to the last candidate, infinite if the list is complete
+    //the same entries by facility: customer id, distance
+    std::vector<long> facility_offsets;
+    std::vector<std::pair<long,long>> facility_entries;
+
+    std::vector<double> lambda;
+    double best_bound = -std::numeric_limits<double>::infinity();
+    long iterations = 0;
+
+    //per iteration: reduced costs of a facility, totals, customers served in the relaxed solution
+    std::vector<std::pair<double,long>> reduced;
+    std::vector<std::pair<double,long>> totals;
+    std::vector<long> served;
+
+    /*
+     * Take up to <candidates> nearest facilities of every customer from the generator
+     */
+    LagrangianBound(EdgeGenerator* generator, std::vector<long> capacities, long facilities_to_locate, long candidates) {
+        this->n = generator->n;
+        this->m = generator->m;
+        this->capacities = capacities;
+        this->facilities_to_locate = facilities_to_locate;
+        customer_offsets.assign(n + 1, 0);
+        max_lambda.assign(n, std::numeric_limits<double>::infinity());
+        facility_offsets.assign(m + 1, 0);
+        for (long i = 0; i < n; i++) {
+            long count = 0;
+            while (count < candidates && !generator->isComplete(i)) {
+                newEdge e = generator->getEdge(i);
+                customer_entries.push_back(std::make_pair(e.target_node - n, e.weight));
+                facility_offsets[e.target_node - n + 1]++;
+                count++;
+            }
+            if (count == candidates) {
+                max_lambda[i] = customer_entries.back().second;
+            }
+            if (count == 0) {
+                feasible = false;
+            }
+            customer_offsets[i + 1] = customer_entries.size();
+        }
+        for (long j = 0; j < m; j++) {
+            facility_offsets[j + 1] += facility_offsets[j];
+        }
+        facility_entries.resize(customer_entries.size());
+        std::vector<long> next(facility_offsets.begin(), facility_offsets.end() - 1);
+        for (long i = 0; i < n; i++) {
+            for (long e = customer_offsets[i]; e < customer_offsets[i + 1]; e++) {
+                facility_entries[next[customer_entries[e].first]++] = std::make_pair(i, customer_entries[e].second);
+            }
+        }
+        //all customers at their nearest facilities, L(lambda) is the uncapacitated bound
+        lambda.resize(n);
+        for (long i = 0; i < n; i++) {
+            lambda[i] = customer_offsets[i] < customer_offsets[i + 1] ? customer_entries[customer_offsets[i]].second : 0;
+        }
+        served.resize(n);
+    }
+
+    /*
+     * L(lambda), served[i] is set to the number of opened facilities that serve customer i in the relaxed solution
+     */
+    double evaluate() {
+        double result = 0;
+        for (long i = 0; i < n; i++) {
+            result += lambda[i];
+            served[i] = 0;
+        }
+        totals.clear();
+        for (long j = 0; j < m; j++) {
+            double total = 0;
+            selectCustomers(j);
+            for (long r = 0; r < reduced.size(); r++) {
+                total += reduced[r].first;
+            }
+            totals.push_back(std::make_pair(total, j));
+        }
+        long open = std::min(facilities_to_locate, m);
+        if (open == 0) {
+            return result;
+        }
+        std::nth_element(totals.begin(), totals.begin() + open - 1, totals.end());
+        for (long t = 0; t < open; t++) {
+            result += totals[t].first;
+            selectCustomers(totals[t].second);
+            for (long r = 0; r < reduced.size(); r++) {
+                served[reduced[r].second]++;
+            }
+        }
+        return result;
+    }
+
+    /*
+     * Customers of facility j with the most negative reduced costs, at most its capacity, into <reduced>
+     */
+    void selectCustomers(long j) {
+        reduced.clear();
+        for (long e = facility_offsets[j]; e < facility_offsets[j + 1]; e++) {
+            double cost = facility_entries[e].second - lambda[facility_entries[e].first];
+            if (cost < 0) {
+                reduced.push_back(std::make_pair(cost, facility_entries[e].first));
+            }
+        }
+        if (reduced.size() > capacities[j]) {
+            std::nth_element(reduced.begin(), reduced.begin() + capacities[j], reduced.end());
+            reduced.resize(capacities[j]);
+        }
+    }
+
+    /*
+     * Subgradient optimization towards <upper_bound> (objective of a feasible solution), return the best bound
+     */
+    double run(double upper_bound) {
+        if (!feasible || m == 0) {
+            best_bound = std::numeric_limits<double>::infinity();
+            return best_bound;
+        }
+        double step = initial_step;
+        long stalled = 0;
+        for (iterations = 0; iterations < max_iterations && step > min_step; iterations++) {
+            double bound = evaluate();
+            if (bound > best_bound + 1e-9) {
+                best_bound = bound;
+                stalled = 0;
+            } else if (++stalled >= patience) {
+                step /= 2;
+                stalled = 0;
+            }
+            double norm = 0;
+            for (long i = 0; i < n; i++) {
+                norm += (double) (1 - served[i]) * (1 - served[i]);
+            }
+            if (norm == 0 || best_bound >= upper_bound) {
+                break; //relaxed solution is feasible or the gap is closed
+            }
+            double t = step * (upper_bound - bound) / norm;
+            for (long i = 0; i < n; i++) {
+                lambda[i] = std::min(lambda[i] + t * (1 - served[i]), max_lambda[i]);
+            }
+        }
+        return best_bound;
+    }
+};
+
+/*
+ * Log a lower bound next to the objective of a solution of the network. Capacities from the facility file do not
+ * go below the uniform one, so the bound holds whichever of them the solver used.
+ */
+inline void log_lagrangian_bound(Network& network, long facilities_to_locate, long facility_capacity, long candidates,
+                                 bool use_ch, Logger* logger) {
+    if (logger->float_dict.count("objective") == 0 || logger->str_dict.count("error") > 0) {
+        return;
+    }
+    double objective = logger->float_dict["objective"][0];
+    logger->start("lower bound time");
+    std::vector<long> capacities(network.target_indexes.size(), facility_capacity);
+    for (long j = 0; j < network.target_capacities.size() && j < capacities.size(); j++) {
+        capacities[j] = std::max(capacities[j], network.target_capacities[j]);
+    }
+    EdgeGenerator* generator = make_target_edge_generator(network, network.target_indexes, use_ch);
+    LagrangianBound bound(generator, capacities, facilities_to_locate, candidates);
+    delete generator;
+    double result = bound.run(objective);
+    logger->finish("lower bound time");
+    if (!std::isfinite(result)) { //no facilities or a customer without any, infinity is not valid json
+        logger->add("lower bound error", std::string("no facility for some customer"));
+        return;
+    }
+    logger->add("lower bound", result);
+    logger->add("lower bound iterations", bound.iterations);
+    logger->add("lower bound gap", objective > 0 ? (objective - result) / objective : 0);
+}
+
+#endif //FCLA_LAGRANGIANBOUND_H
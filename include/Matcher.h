@@ -19,27 +19,31 @@
 #include <utility>
 
 #include "nheap.h"
+#include "DaryHeap.h"
 #include "helpers.h"
 #include "EdgeGenerator.h"
 #include "TargetExploringEdgeGenerator.h"
 #include "Logger.h"
 #include "exceptions.h"
-#include "Hilbert.h"
+#include "HilbertOrder.h"
+#include "ResidualGraph.h"
 
 /*
  * Template types stand for
- * < flow/supply type, weight/potentials/cost type, node/edge index type >
+ * < flow/supply type, weight/potentials/cost type, node/edge index type, heap used in Dijkstra >
+ * Dijkstra heap keys are not monotone (nodes are re-enheaped when new edges are added), so a heap policy
+ * must support arbitrary keys: fHeap or DaryHeap.
  */
-template<typename F, typename W, typename I>
+template<typename F, typename W, typename I, class DHeap = fHeap<W,I>>
 class Matcher {
 public:
     const W INF_W = std::numeric_limits<W>::max();
     const W VERY_BIG_W = 1000000; // weight for uncapacitated-case extra node
-    //bigraph as two linked lists, storing only non-full edges
+    //bigraph as pooled linked lists, storing only non-full edges
     typedef std::pair<I,W> Edge;
-    typedef std::forward_list<Edge> Adjlist;
-    typedef typename Adjlist::iterator EdgeIterator;
-    std::vector<Adjlist> edges; // decreasing order of weights
+    typedef ResidualGraph<I,W> Residual;
+    typedef typename Residual::iterator EdgeIterator;
+    Residual edges; // decreasing order of weights
     std::vector<std::vector<Edge>> backwards_edges; //for greedy, increasing order
     std::vector<F> node_excess;
     std::vector<F> full_node_excess;
@@ -53,6 +57,15 @@ public:
     std::vector<long> hilbert_order;
     int greedyMatchingOrder = 0;
 
+    //greedy matching is kept between demand increases: customers with grown demand are matched again in the order
+    //of the last full greedy matching and take places of customers later in it, those are matched again in turn
+    bool incremental_greedy = true;
+    std::vector<long> greedy_cursor; //per customer: backwards edges before it are matched or were capacitated
+    std::vector<long> greedy_position; //position of a customer in the order of the last full greedy matching
+    bool greedy_order_is_final = false; //the order would not change in the next full greedy matching
+    std::vector<long> greedy_pending; //customers with demand increased since the last greedy matching
+    std::vector<bool> greedy_is_pending;
+
     //handle uncapacitated case
     std::vector<bool> extra_edge_added_per_source;
 
@@ -63,9 +76,14 @@ public:
     I source_count; //target count is graph_size-source_count, maybe refactor later
 
     //local variables (preserve only for one iteration)
+    //mindist and backtrack of a node are valid only if it is stamped with the current visit epoch
     std::vector<W> mindist;
     std::vector<I> backtrack;
-    fHeap<W,I> dheap;
+    std::vector<I> backtrack_edge; //handle of the residual edge from backtrack[v] to v
+    std::vector<unsigned> visit_stamp;
+    unsigned visit_epoch = 0;
+    std::vector<I> visited; //nodes reached in the current iteration
+    DHeap dheap;
     fHeap<W,I> gheap; //@todo what about enheaping the first node? what about dist of all nodes of dheap between iterations?
 
     //arrays with results
@@ -89,16 +107,19 @@ public:
         total_matched.resize(source_count, 0);
 
         potentials.resize(graph_size, 0);
-        edges.resize(graph_size);
+        edges.reset(graph_size);
         backwards_edges.resize(graph_size);
         for (I i = 0; i < graph_size; i++) {
-            edges[i].clear();
             backwards_edges[i].clear();
         }
 
         extra_edge_added_per_source.clear();
         extra_edge_added_per_source.resize(source_count, false);
 
+        greedy_cursor.assign(source_count, 0);
+        greedy_pending.clear();
+        greedy_is_pending.assign(source_count, false);
+
         //init with a first nearest neighbor for all source vertices
         edge_generator->reset();
         new_edges.clear();
@@ -117,6 +138,10 @@ public:
 
         mindist.resize(graph_size);
         backtrack.resize(graph_size);
+        backtrack_edge.resize(graph_size);
+        visit_stamp.assign(graph_size, 0);
+        visit_epoch = 0;
+        visited.clear();
     }
 
     //for Facility Location inheritance
@@ -166,6 +191,12 @@ public:
      */
     inline bool updateMindist(I v_id, W new_distance)
     {
+        if (visit_stamp[v_id] != visit_epoch) {
+            visit_stamp[v_id] = visit_epoch;
+            visited.push_back(v_id);
+            mindist[v_id] = new_distance;
+            return true;
+        }
         W cur_dist = mindist[v_id];
         if (cur_dist > new_distance) {
             mindist[v_id] = new_distance;
@@ -174,6 +205,14 @@ public:
         return false;
     }
 
+    /*
+     * Minimum distance found in the current iteration, INF for not reached nodes
+     */
+    inline W getMindist(I v_id)
+    {
+        return visit_stamp[v_id] == visit_epoch ? mindist[v_id] : INF_W;
+    }
+
     /*
      * Initialize vectors and variables for Dijkstra
      */
@@ -183,11 +222,14 @@ public:
         gheap.clear(); //global heap stores information of the next not-added neighbor of vertices
         dheap.clear(); //heap used in Dijkstra
 
-        //initialize heaps and vectors according to a source node
-        std::fill(mindist.begin(),mindist.end(), INF_W);
-        mindist[source_id] = 0;
-
-        std::fill(backtrack.begin(), backtrack.end(), -1);
+        //initialize vectors according to a source node: only stamps of reached nodes are invalidated
+        visit_epoch++;
+        if (visit_epoch == 0) { //stamps wrapped around, invalidate explicitly
+            std::fill(visit_stamp.begin(), visit_stamp.end(), 0);
+            visit_epoch = 1;
+        }
+        visited.clear();
+        updateMindist(source_id, 0);
         backtrack[source_id] = source_id;
 
         //enqueue first node into Dijktra heap
@@ -218,6 +260,7 @@ public:
                 if (updateMindist(target_node, new_cost)) {
                     //update breadcrumbs
                     backtrack[target_node] = current_node;
+                    backtrack_edge[target_node] = it.handle();
                     //update or enqueue target node
                     dheap.updateorenqueue(target_node, new_cost);
                     //maintain global heap (value for target_node was changed because of mindist
@@ -246,7 +289,7 @@ public:
         //note, that we don't have to check all outgoing edges, but consideration of the new edge
         //is nothing but a part of dijkstra execution starting from source node,
         //so we do a bit of overhead in order to minimize amount of code
-        if (mindist[new_edge.source_node] < INF_W) //otherwise we will have overflow of long when calculating INF+something as new distance
+        if (getMindist(new_edge.source_node) < INF_W) //otherwise we will have overflow of long when calculating INF+something as new distance
             dheap.updateorenqueue(new_edge.source_node, mindist[new_edge.source_node]);
     }
 
@@ -325,12 +368,13 @@ public:
      * Update potentials for all visited nodes
      *
      * Maintain potentials so that there are no negative weights: new = old + (dist[target] - dist[current])
-     * Do it for all nodes where dist < dist[target] (mindist), finding nodes by BFS
+     * Do it for all nodes where dist < dist[target] (mindist), only reached nodes can satisfy it
      */
     void updatePotentials(I target)
     {
         W target_distance = mindist[target];
-        for (I i = 0; i < graph_size; i++) {
+        for (I k = 0; k < visited.size(); k++) {
+            I i = visited[k];
             if (mindist[i] < target_distance) {
                 potentials[i] = potentials[i] + target_distance - mindist[i];
             }
@@ -358,33 +402,10 @@ public:
 
         //iterate throw forward path and reassign edges to the opposite nodes (flip them)
         while (backtrack[current_node] != current_node) {
-            //find an edge in adj list
-            I target_node = current_node; //note this! we are back-propagating
-            I source_node = backtrack[current_node];
-
-            //find an edge
-            EdgeIterator it = edges[source_node].begin();
-            //we should erase *it, change weight to the opposite and assign to target
-            //note that linked list has only "remove after" operation
-            W weight;
-            if (it->first == target_node) {
-                weight = -it->second;
-                edges[source_node].pop_front();
-            } else {
-                EdgeIterator prev_it = it;
-                it++;
-                while(true) { //strong assumption on graph structure consistency
-                    if (it->first == target_node) {
-                        break;
-                    }
-                    prev_it = it;
-                    it++;
-                }
-                weight = -it->second;
-                edges[source_node].erase_after(prev_it);
-            }
-            edges[target_node].push_front(std::make_pair(source_node,weight));
-            current_node = source_node;
+            //the edge that led to the current node is known, no search in adjacency list
+            //we are back-propagating
+            edges.flip(backtrack_edge[current_node]);
+            current_node = backtrack[current_node];
         }
 
         //current node contains the source node after while loop, so we change node_excess
@@ -470,6 +491,18 @@ public:
                 this->makeRandomSourceOrder(source_ids);
                 break;
         }
+        //random order is drawn again, distance order depends on the closest facility that is unknown
+        //for customers without explored edges
+        greedy_order_is_final = this->greedyMatchingOrder == 2 || this->greedyMatchingOrder == 3;
+        for (long i = 0; i < source_ids.size() && this->greedyMatchingOrder == 3; i++) {
+            greedy_order_is_final = greedy_order_is_final && backwards_edges[i].size() > 0;
+        }
+        greedy_position.resize(source_ids.size());
+        for (long i = 0; i < source_ids.size(); i++) {
+            greedy_position[source_ids[i]] = i;
+        }
+        greedy_pending.clear();
+        greedy_is_pending.assign(source_count, false);
         for (auto it = source_ids.begin(); it != source_ids.end(); it++) {
             if (!this->matchToClosestAvailableFacility(*it)) {
                 explored_sources.push_back((*it));
@@ -479,46 +512,64 @@ public:
         return explored_sources;
     }
 
-    void makeRandomSourceOrder(std::vector<long>& sources) {
-        std::random_shuffle(sources.begin(), sources.end());
+    /*
+     * Greedy matching can be continued by matchGreedyIncrement, otherwise assignments are reset and matched again
+     */
+    bool canMatchGreedyIncrementally() {
+        return this->incremental_greedy && this->greedy_order_is_final && greedy_position.size() == source_count;
     }
 
-    struct Customer {
-        Coords coords;
-        long index;
-    };
-
-    struct ComparatorHilbertEntry
-    {
-        bool operator()(const Customer& r1, const Customer& r2)
-        {
-            double d1[2],d2[2];
-            d1[0] = r1.coords.first;
-            d1[1] = r1.coords.second;
-            d2[0] = r2.coords.first;
-            d2[1] = r2.coords.second;
-            return hilbert_ieee_cmp(2,d1,d2) >= 0;
+    /*
+     * Match customers whose demand grew since the last greedy matching, keeping other assignments.
+     *
+     * The result is the same as of a full greedy matching in the same order: demands only grow, so a customer
+     * can lose places only to customers before it. Customers are matched in their order, and a customer that
+     * finds a facility capacitated takes a place of the latest customer there if that one comes after it.
+     */
+    std::vector<long> matchGreedyIncrement() {
+        logger->start("greedyMatching");
+        fHeap<long,long> queue; //customers to match by position
+        for (long i = 0; i < greedy_pending.size(); i++) {
+            queue.enqueue(greedy_pending[i], greedy_position[greedy_pending[i]]);
+            greedy_is_pending[greedy_pending[i]] = false;
+        }
+        greedy_pending.clear();
+        long rematched = 0;
+        long source_id;
+        while (queue.size() > 0) {
+            queue.dequeue(source_id);
+            rematched++;
+            this->matchToClosestAvailableFacility(source_id, &queue);
+        }
+        //as in the full matching, all customers with unmet demand are returned, not only the rematched ones
+        std::vector<long> explored_sources;
+        for (long i = 0; i < source_count; i++) {
+            if (this->node_excess[i] < 0) {
+                explored_sources.push_back(i);
+            }
         }
-    } hilbert_comparator;
+        logger->add1("greedy rematched customers", rematched);
+        logger->finish("greedyMatching");
+        return explored_sources;
+    }
+
+    void makeRandomSourceOrder(std::vector<long>& sources) {
+        std::random_shuffle(sources.begin(), sources.end());
+    }
 
     void makeHilbertSourceOrder(std::vector<long>& sources) {
         if (this->hilbert_is_ready) {
             sources = this->hilbert_order;
             return;
         }
-        std::vector<Customer> customers;
-        for (auto s : sources) {
-            Coords coords = this->getCustomerCoords(s);
-            customers.push_back({coords, s});
-        }
-        std::cout << "begin hilbert" << std::endl;
-        std::sort(customers.begin(), customers.end(), hilbert_comparator);
+        const std::vector<uint64_t>& node_keys = this->network->get_hilbert_keys();
+        std::vector<uint64_t> keys(sources.size());
         for (long i = 0; i < sources.size(); i++) {
-            sources[i] = customers[i].index;
+            keys[i] = node_keys[this->network->source_indexes[sources[i]]];
         }
+        HilbertOrder::sort(sources, keys);
         this->hilbert_order = sources;
         this->hilbert_is_ready = true;
-        std::cout << "hilbert ready" << std::endl;
     }
 
     Coords getCustomerCoords(long source_id) {
@@ -541,46 +592,87 @@ public:
     }
 
     long getDistanceToClosestAvailableFacility(long source_id) {
-        for (auto edge : this->backwards_edges[source_id]) {
-            if (!this->ifTargetCapacitated(edge.first)) {
-                return edge.second;
+        std::vector<Edge>& explored = this->backwards_edges[source_id];
+        for (long i = this->greedy_cursor[source_id]; i < explored.size(); i++) {
+            if (!this->ifTargetCapacitated(explored[i].first)) {
+                return explored[i].second;
             }
         }
         return VERY_BIG_W;
     }
 
-    bool matchToClosestAvailableFacility(long source_id) {
+    /*
+     * A facility has a place for a customer. If <queue> is given, a place of a customer that comes later
+     * in the greedy order is freed, and that customer is queued to be matched again.
+     * The latest customer is found by a scan of the residual arcs of the facility, one per matched customer, so a
+     * probe of a capacitated facility costs O(capacity). A heap of customers per facility would have to follow every
+     * augmenting path of the flow matching that rewires these arcs, capacities are small enough to scan instead
+     */
+    bool isAvailableForGreedy(long target_node, long source_id, fHeap<long,long>* queue) {
+        if (!this->ifTargetCapacitated(target_node)) {
+            return true;
+        }
+        if (queue == NULL) {
+            return false;
+        }
+        EdgeIterator latest = edges[target_node].end();
+        for (EdgeIterator it = edges[target_node].begin(); it != edges[target_node].end(); it++) {
+            if (latest == edges[target_node].end() || greedy_position[it->first] > greedy_position[latest->first]) {
+                latest = it;
+            }
+        }
+        if (latest == edges[target_node].end() || greedy_position[latest->first] <= greedy_position[source_id]) {
+            return false;
+        }
+        long displaced = latest->first;
+        edges.erase(latest.handle());
+        node_excess[displaced]--;
+        node_excess[target_node]++;
+        if (!queue->isExisted(displaced)) {
+            queue->enqueue(displaced, greedy_position[displaced]);
+        }
+        return true;
+    }
+
+    /*
+     * Match a customer to closest facilities with free capacity until its demand is met.
+     * Facilities before the cursor of a customer are skipped: they are matched to it already or capacitated
+     * by customers before it, which keep their places until the next full greedy matching
+     */
+    bool matchToClosestAvailableFacility(long source_id, fHeap<long,long>* queue = NULL) {
         if (this->node_excess[source_id] == 0) {
             return true;
         }
-        auto it = backwards_edges[source_id].begin();
+        std::vector<Edge>& explored = backwards_edges[source_id];
+        long position = greedy_cursor[source_id];
         W weight;
         long target_node;
         long closestFacility = 0;
         while (this->node_excess[source_id] < 0) {
-            while (it == backwards_edges[source_id].end() || this->ifTargetCapacitated(it->first)) {
+            while (position == explored.size() || !this->isAvailableForGreedy(explored[position].first, source_id, queue)) {
                 closestFacility++;
-                if (it == backwards_edges[source_id].end()) {
+                if (position == explored.size()) {
                     newEdge new_edge = this->edge_generator->getEdge(source_id);
                     if (!new_edge.exists) {
+                        greedy_cursor[source_id] = position;
                         logger->add(std::string("furthest traversal ") + std::to_string(source_id), -1);
                         return false;
                     }
                     edges[source_id].push_front(std::make_pair(new_edge.target_node, new_edge.weight));
-                    backwards_edges[source_id].push_back(std::make_pair(new_edge.target_node, new_edge.weight));
-                    it = std::prev(backwards_edges[source_id].end());
+                    explored.push_back(std::make_pair(new_edge.target_node, new_edge.weight));
                 } else {
-                    it++;
+                    position++;
                 }
             }
-            weight = -it->second;
-            target_node = it->first;
+            weight = -explored[position].second;
+            target_node = explored[position].first;
             edges[target_node].push_front(std::make_pair(source_id,weight));
             node_excess[source_id]++;
             node_excess[target_node]--;
 
-            it++; // because we can not match twice with the same facility
+            position++; // because we can not match twice with the same facility
         }
+        greedy_cursor[source_id] = position;
         logger->add(std::string("furthest traversal ") + std::to_string(source_id), closestFacility);
         return true;
     }
@@ -602,6 +694,10 @@ public:
 
         if (this->greedyMatching) {
             this->full_node_excess[vid] -= 1;
+            if (!this->greedy_is_pending[vid]) {
+                this->greedy_is_pending[vid] = true;
+                this->greedy_pending.push_back(vid);
+            }
             return 1;
         }
 
@@ -668,9 +764,7 @@ public:
     }
 
     inline long get_bi_outdegree(long bi_node_id) {
-        long i = 0;
-        for (auto &x : this->edges[bi_node_id]) i++;
-        return i;
+        return this->edges[bi_node_id].size();
     }
 
     void print_edgelist() {
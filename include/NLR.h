@@ -8,24 +8,35 @@
  * Note that for the first iteration if there is no existing facility, then a full distance matrix will be
  * calculated and sorted nearest neighbour list created. Then, only nearest neighbor list traversal is required,
  * that takes the same time if all nodes are available for facilities.
+ *
+ * NLRs are calculated once and then maintained incrementally: a placed facility only cuts the lists of customers
+ * in its own NLR, other customers are not touched.
  */
 
 #ifndef FCLA_NLR_H
 #define FCLA_NLR_H
 
 #include <vector>
-#include <forward_list>
 #include <stdexcept>
 #include <map>
+#include <utility>
 
 #include "Logger.h"
 #include "Matcher.h"
 #include "TargetExploringEdgeGenerator.h"
+#include "CHEdgeGenerator.h"
 #include "Network.h"
 #include "helpers.h"
 #include "exceptions.h"
+#include "nheap.h"
+#include "DaryHeap.h"
+#include "RadixHeap.h"
 
-class NLR {
+/*
+ * Heap is the policy of the Dijkstra heap used by edge generators (fHeap, DaryHeap or RadixHeap)
+ */
+template<class Heap>
+class BasicNLR {
 public:
     struct {
         bool any_facility_nlr = true; // NLRs are calculated as the distance to any placed facility, ignoring capacitated ones
@@ -48,10 +59,22 @@ public:
     std::vector<bool> facility_located; // indicate if potential facility location is occupied by placed facility
     std::vector<bool> facility_capacitated; // indicate if potential facility location is capacitated
 
-    std::vector<std::forward_list<long>> nearest_facilities; //facilities per customer (indexes in facility_indexes)
-    std::vector<std::vector<long>> nlrs; //inverse index per facility
+    std::vector<std::vector<long>> nearest_facilities; //facilities per customer (indexes in facility_indexes), traversed from the back
+    std::vector<std::vector<long>> nlrs; //inverse index per facility, entries of customers cut off later are kept
+    std::vector<std::vector<long>> nlr_positions; //per facility: position of the facility in the list of a customer in nlrs
+    std::vector<long> nlr_size; //per facility: customers in its NLR
+
+    //a customer is in NLRs of facilities nearest_facilities[c][nlr_begin[c]..nlr_end[c])
+    std::vector<long> nlr_begin;
+    std::vector<long> nlr_end;
+    std::vector<long> nlr_outdated; //customers calculated again before the next placement
+
+    //facilities by NLR size (the smallest index first among equal sizes), sizes of entries are updated lazily:
+    //an entry is corrected when it reaches the top, located and unavailable facilities are dropped
+    fHeap<std::pair<long,long>,long> nlr_heap;
 
     EdgeGenerator* edge_generator;
+    bool use_ch = false; //distances by contraction hierarchy instead of exploration
     Logger* logger;
 
     long objective;
@@ -64,7 +87,7 @@ public:
         this->facility_located.resize(this->facility_indexes.size(), false);
         this->facility_capacitated.clear();
         this->facility_capacitated.resize(this->facility_indexes.size(), false);
-        this->nearest_facilities = std::vector<std::forward_list<long>>(this->customer_indexes.size(), std::forward_list<long>());
+        this->nearest_facilities = std::vector<std::vector<long>>(this->customer_indexes.size(), std::vector<long>());
         this->edge_generator->reset();
         clearNLRs();
     }
@@ -86,12 +109,41 @@ public:
         return false; // facility is capacitated and/or located
     }
 
+    void addToNLR(long customer_index, long position) {
+        long facility_index = this->nearest_facilities[customer_index][position];
+        this->nlrs[facility_index].push_back(customer_index);
+        this->nlr_positions[facility_index].push_back(position);
+        this->nlr_size[facility_index]++;
+        if (this->nlr_heap.isExisted(facility_index)) {
+            //heap entries may only overestimate sizes
+            this->nlr_heap.updatequeue(facility_index, std::make_pair(this->nlr_size[facility_index], -facility_index));
+        }
+    }
+
+    /*
+     * Remove the customer from NLRs of facilities at positions [nlr_begin, end) of its list
+     */
+    void cutNLR(long customer_index, long end) {
+        std::vector<long>& nearest = this->nearest_facilities[customer_index];
+        for (long i = this->nlr_begin[customer_index]; i < end; i++) {
+            this->nlr_size[nearest[i]]--;
+        }
+        this->nlr_begin[customer_index] = end;
+    }
+
     void calculateNLR(long customer_index) {
         // add the customer to nlrs of all facilities that are closer than the closest occupied facility
-        for(auto const& nearest_facility_index: this->nearest_facilities[customer_index]) {
-            if (!ifFacilityInNLR(nearest_facility_index)) return;
-            this->nlrs[nearest_facility_index].push_back(customer_index);
+        std::vector<long>& nearest = this->nearest_facilities[customer_index];
+        for (long position = (long) nearest.size() - 1; position >= 0; position--) {
+            if (!ifFacilityInNLR(nearest[position])) {
+                this->nlr_begin[customer_index] = position + 1;
+                this->nlr_end[customer_index] = nearest.size();
+                return;
+            }
+            addToNLR(customer_index, position);
         }
+        this->nlr_begin[customer_index] = 0;
+        this->nlr_end[customer_index] = nearest.size();
         //no available facilities found -> fetch more edges
         this->getMoreEdgesUntilOccupiedFacilityFound(customer_index);
     }
@@ -102,26 +154,70 @@ public:
             edge.target_node -= this->customer_indexes.size(); //api of edge generator return id of a node in bgraph
             if (!edge.exists) return; // we traversed all graph and all facilities are in NLR
             long facility_index = edge.target_node;
-//            long facility_index;
-//            assert(this->inverse_facility_index.find(edge.target_node) != this->inverse_facility_index.end());
-//            facility_index = this->inverse_facility_index.at(edge.target_node); //throw out_of_range exception if not found
-            this->nearest_facilities[customer_index].push_front(facility_index);
+            this->nearest_facilities[customer_index].push_back(facility_index);
 
-            if (!ifFacilityInNLR(facility_index)) return;
-            this->nlrs[facility_index].push_back(customer_index);
+            if (!ifFacilityInNLR(facility_index)) {
+                //the occupied facility is traversed first next time, so the NLR becomes empty
+                this->nlr_outdated.push_back(customer_index);
+                return;
+            }
+            addToNLR(customer_index, this->nearest_facilities[customer_index].size() - 1);
+            this->nlr_end[customer_index]++;
         }
         throw std::out_of_range("Trying to fetch too many edges from the graph");
     }
 
     void clearNLRs() {
         this->nlrs = std::vector<std::vector<long>>(this->facility_indexes.size(), std::vector<long>());
+        this->nlr_positions = std::vector<std::vector<long>>(this->facility_indexes.size(), std::vector<long>());
+        this->nlr_size.assign(this->facility_indexes.size(), 0);
+        this->nlr_begin.assign(this->customer_indexes.size(), 0);
+        this->nlr_end.assign(this->customer_indexes.size(), 0);
+        this->nlr_outdated.clear();
     }
 
     void calculateAllNLRs() {
         clearNLRs();
+        this->nlr_heap.clear();
+        this->nlr_heap.sign = 1; //make heap decreasing order
         for(long i = 0; i < this->customer_indexes.size(); i++) {
             calculateNLR(i);
         }
+        for (long i = 0; i < this->facility_indexes.size(); i++) {
+            if (isFacilityAvailable(i)) {
+                this->nlr_heap.enqueue(i, std::make_pair(this->nlr_size[i], -i));
+            }
+        }
+    }
+
+    /*
+     * Cut NLRs of customers that contain a newly placed facility: facilities after it in the traversal order
+     * are not in the NLR any more. Other customers keep their NLRs.
+     */
+    void shrinkNLRs(long facility_index) {
+        if (ifFacilityInNLR(facility_index)) {
+            return;
+        }
+        std::vector<long>& customers = this->nlrs[facility_index];
+        std::vector<long>& positions = this->nlr_positions[facility_index];
+        for (long k = 0; k < customers.size(); k++) {
+            long customer_index = customers[k];
+            if (positions[k] >= this->nlr_begin[customer_index] && positions[k] < this->nlr_end[customer_index]) {
+                cutNLR(customer_index, positions[k] + 1);
+            }
+        }
+        //all entries are cut off
+        std::vector<long>().swap(customers);
+        std::vector<long>().swap(positions);
+    }
+
+    void updateNLRs() {
+        std::vector<long> outdated;
+        outdated.swap(this->nlr_outdated);
+        for (long k = 0; k < outdated.size(); k++) {
+            cutNLR(outdated[k], this->nlr_end[outdated[k]]);
+            calculateNLR(outdated[k]);
+        }
     }
 
     void matchFacilities(bool allow_infeasible = true) {
@@ -133,18 +229,26 @@ public:
             new_excess[i] = this->facility_capacities[facility_index];
         }
 
-        TargetExploringEdgeGenerator<long, long> bigraph_generator(*this->network, this->located_facility_target_indexes);
-        Matcher<long,long,long> M(&bigraph_generator, new_excess, this->logger);
+        EdgeGenerator* bigraph_generator = make_target_edge_generator<Heap>(*this->network, this->located_facility_target_indexes, this->use_ch);
+        Matcher<long,long,long> M(bigraph_generator, new_excess, this->logger);
         M.network = this->network;
         M.match();
 
+        std::map<long, long> bgraph_index; //located facility node -> node in bgraph
+        for (long i = 0; i < this->located_facility_target_indexes.size(); i++) {
+            bgraph_index[this->located_facility_target_indexes[i]] = this->customer_indexes.size() + i;
+        }
+
         // 3-level index mapping: facility index in this class -> index in graph -> index in bgraph
         for(long i = 0; i < this->facility_indexes.size(); i++) {
             long potential_facility_index_in_this_class = i;
             if (this->facility_located[potential_facility_index_in_this_class]) {
                 long located_facility_index_in_graph = this->facility_indexes[potential_facility_index_in_this_class];
-                long located_facility_index_in_bgraph = bigraph_generator.getIndexOfFacilityInBGraph(located_facility_index_in_graph);
-                assert(located_facility_index_in_bgraph >= 0);
+                std::map<long, long>::const_iterator found = bgraph_index.find(located_facility_index_in_graph);
+                if (found == bgraph_index.end()) {
+                    throw std::logic_error("Located facility is missing in the matching graph");
+                }
+                long located_facility_index_in_bgraph = found->second;
                 this->facility_capacitated[i] = M.ifTargetCapacitated(located_facility_index_in_bgraph);
             }
         }
@@ -153,6 +257,7 @@ public:
             M.calculateResult(); //for the last iteration matching must be feasible, otherwise FL is infeasible
             this->objective = M.result_weight;
         }
+        delete bigraph_generator;
     }
 
     void placeAllFacilities() {
@@ -161,7 +266,11 @@ public:
 //            matchFacilities();
 //            this->logger->finish("matching");
             this->logger->start("calculate nlrs");
-            calculateAllNLRs();
+            if (i == 0) {
+                calculateAllNLRs();
+            } else {
+                updateNLRs(); //placed facilities have already cut NLRs
+            }
             this->logger->finish("calculate nlrs");
             this->logger->start("place facility");
             placeFacility();
@@ -169,23 +278,27 @@ public:
         }
     }
 
+    inline bool isFacilityAvailable(long facility_index) {
+        long fac_component = this->component_of_potential_facility_location[facility_index];
+        return !this->facility_located[facility_index] && this->facilities_available_per_component[fac_component] > 0;
+    }
+
     inline long getBestFacility() {
-        // traverse NLRs and find the most covered one
-        long maxIndex;
-        long maxCoverage = -1;
-        for (long i = 0; i < this->facility_indexes.size(); i++) {
-            long coverage = this->nlrs[i].size();
-            long fac_component = this->component_of_potential_facility_location[i];
-            bool available_in_component = this->facilities_available_per_component[fac_component] > 0;
-            if (coverage > maxCoverage && !this->facility_located[i] && available_in_component) {
-                maxIndex = i;
-                maxCoverage = coverage;
+        // take the most covered facility from the heap, correcting outdated sizes on the way
+        long facility_index;
+        while (this->nlr_heap.size() > 0) {
+            facility_index = this->nlr_heap.getTopIdx();
+            if (!isFacilityAvailable(facility_index)) {
+                this->nlr_heap.dequeue(facility_index); //facilities never become available again
+                continue;
             }
+            if (this->nlr_heap.getTopValue().first != this->nlr_size[facility_index]) {
+                this->nlr_heap.updatequeue(facility_index, std::make_pair(this->nlr_size[facility_index], -facility_index));
+                continue;
+            }
+            return facility_index;
         }
-        if (maxCoverage == -1) {
-            throw infeasible_solution; //all facilities are occupied, but customers are not yet satisfied
-        }
-        return maxIndex;
+        throw infeasible_solution; //all facilities are occupied, but customers are not yet satisfied
     }
 
     void placeFacility() {
@@ -193,7 +306,8 @@ public:
         this->located_facility_indexes.push_back(best_facility);
         this->located_facility_target_indexes.push_back(this->facility_indexes[best_facility]);
         this->facility_located[best_facility] = true;
-        
+        shrinkNLRs(best_facility);
+
         long fac_component = this->component_of_potential_facility_location[best_facility];
         this->facilities_available_per_component[fac_component]--;
     }
@@ -267,13 +381,9 @@ public:
     }
     
     void calculateMaxFacilitiesPerComponent() {
-        igraph_integer_t components;
-        igraph_vector_t membership;
-        igraph_vector_t csize;
-        igraph_vector_init(&membership,0);
-        igraph_vector_init(&csize,0);
         logger->start("compute components");
-        igraph_clusters(&(network->graph), &membership, &csize, &components, IGRAPH_WEAK);
+        long components = network->components();
+        std::vector<long>& membership = network->component_membership;
         logger->finish("compute components");
         logger->add("number of components", components);
 
@@ -285,7 +395,7 @@ public:
             //calculate customers
             long customers = 0;
             for (long i = 0; i < network->source_indexes.size(); i++) {
-                if (VECTOR(membership)[network->source_indexes[i]] == component_id) {
+                if (membership[network->source_indexes[i]] == component_id) {
                     customers++;
                 }
             }
@@ -296,7 +406,7 @@ public:
             for (long i = 0; i < network->target_indexes.size(); i++) {
                 long places = 0;
                 long min_capacity = 100000;
-                if (VECTOR(membership)[network->target_indexes[i]] == component_id) {
+                if (membership[network->target_indexes[i]] == component_id) {
                     this->component_of_potential_facility_location[i] = component_id;
                     places += this->facility_capacities[i];
                     if (min_capacity > this->facility_capacities[i]) {
@@ -309,24 +419,23 @@ public:
 
             std::vector<long> component_node_indexes;
             for (long i = 0; i < network->graph_size(); i++) {
-                if (VECTOR(membership)[i] == component_id) {
+                if (membership[i] == component_id) {
                     component_node_indexes.push_back(i);
                 }
             }
             node_indexes_per_component.push_back(component_node_indexes);
         }
-        igraph_vector_destroy(&membership);
-        igraph_vector_destroy(&csize);
 
         get_facilities_available_per_component(customers_per_component, capacities_per_component, min_capacity_per_component);
     }
 
-    NLR(Network& network, Logger* logger, long facility_capacity, long required_facilities) {
+    BasicNLR(Network& network, Logger* logger, long facility_capacity, long required_facilities, bool use_ch = false) {
         //setting variables once per multiple algorithm runs
         this->logger = logger;
         this->network = &network;
         this->required_facilities = required_facilities;
-        this->edge_generator = new TargetExploringEdgeGenerator<long, long>(network, network.target_indexes);
+        this->use_ch = use_ch;
+        this->edge_generator = make_target_edge_generator<Heap>(network, network.target_indexes, use_ch);
         this->facility_indexes = network.target_indexes;
         buildInverseFacilityIndex();
         this->facility_capacities = network.target_capacities;
@@ -340,7 +449,7 @@ public:
         calculateMaxFacilitiesPerComponent();
     }
 
-    ~NLR() {}
+    ~BasicNLR() {}
 
     void run() {
         reset();
@@ -360,4 +469,6 @@ public:
     }
 };
 
+typedef BasicNLR<fHeap<long,long>> NLR;
+
 #endif //FCLA_NLR_H
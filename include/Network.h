@@ -6,23 +6,89 @@
 #define FCLA_NETWORK_H
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
 #include <string>
+#include <cstring>
+#include <stdexcept>
 #include <igraph/igraph.h>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <time.h>
 #include "exceptions.h"
+#include "CSRGraph.h"
+#include "ContractionHierarchy.h"
+#include "HilbertOrder.h"
+
+/*
+ * Binary network format (.ntwb), version 1
+ *
+ * A header followed by 8-byte aligned columns, each column is addressed by its byte offset from the file start
+ * (0 if the column is absent). Integers are int64, coordinates are pairs of doubles, all in native byte order.
+ * CSR arcs are stored as CSRGraph::Arc, so a mapped file is traversed without any copy.
+ */
+#define NTWB_MAGIC "NTWB"
+#define NTWB_VERSION 1
+#define NTWB_EXTENSION ".ntwb"
+
+enum NtwbFlags {
+    NTWB_HAS_COORDS = 1,
+    NTWB_HAS_TARGETS = 2, //list of potential facilities with capacities
+    NTWB_HAS_CSR = 4,
+    NTWB_HAS_COMPONENTS = 8
+};
+
+struct NtwbHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t id_length;
+    int64_t node_count;
+    int64_t edge_count;
+    int64_t source_count;
+    int64_t target_count;
+    int64_t component_count;
+    uint64_t id_offset;
+    uint64_t edges_offset; //from,to pairs
+    uint64_t weights_offset;
+    uint64_t sources_offset;
+    uint64_t coords_offset;
+    uint64_t targets_offset;
+    uint64_t capacities_offset;
+    uint64_t csr_offsets_offset;
+    uint64_t csr_arcs_offset;
+    uint64_t components_offset;
+};
+
+inline bool has_extension(const std::string& filename, const std::string& extension) {
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
 
 class Network {
 public:
-    igraph_t graph;
+    igraph_t graph; //interoperability layer built on demand by get_graph(), algorithms traverse csr
+    bool graph_built = false;
+    CSRGraph csr;
     std::string id;
+    std::vector<long> edges; //edges[2*i], edges[2*i+1] are endpoints of edge i
     std::vector<long> weights;
     std::vector<long> source_indexes;
     std::vector<long> target_indexes;
     std::vector<long> target_capacities;
     std::vector<std::pair<double,double>> coords; //in case there are coordinates
+    std::vector<long> component_membership; //weak component id per node, filled by components()
+    long component_count = -1;
+
+    ContractionHierarchy* ch = nullptr; //built on demand by get_ch()
+    std::vector<uint64_t> hilbert_keys; //per node, filled by get_hilbert_keys()
+
+    //memory mapping of a binary network, csr may point into it
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
 
     static std::string generate_id() {
         struct timespec spec;
@@ -32,6 +98,7 @@ public:
         return strtime.substr(0, strtime.size()-3) + std::to_string(rand() % 1000);
     }
 
+    Network() {} //empty network, filled by extract_components
     Network(std::string filename, std::string facilityfilename = "") {
         this->load(filename, facilityfilename);
     }
@@ -39,8 +106,7 @@ public:
             std::vector<long>& weights,
             std::vector<long>& source_indexes,
             std::vector<Coords>& coords) {
-        igraph_copy(&this->graph, g);
-        this->weights = weights;
+        this->set_graph(g, weights);
         this->source_indexes = source_indexes;
         this->coords = coords;
 
@@ -50,8 +116,7 @@ public:
     Network(igraph_t* g,
             std::vector<long>& weights,
             std::vector<long>& source_indexes) {
-        igraph_copy(&this->graph, g);
-        this->weights = weights;
+        this->set_graph(g, weights);
         this->source_indexes = source_indexes;
         std::vector<std::pair<double, double>> v(weights.size());
         this->coords = v;
@@ -64,12 +129,151 @@ public:
         this->id = strtime.substr(0, strtime.size()-3) + std::to_string(rand() % 1000);
     }
     ~Network() {
-        igraph_destroy(&this->graph);
+        if (graph_built) {
+            igraph_destroy(&this->graph);
+        }
+        delete ch;
+        unmap();
+    }
+    //the mapping, the hierarchy and the igraph layer are owned by one network
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+
+    /*
+     * Contraction hierarchy of the network, preprocessing is done at the first call
+     */
+    ContractionHierarchy* get_ch() {
+        if (ch == nullptr) {
+            ch = new ContractionHierarchy(csr);
+        }
+        return ch;
+    }
+
+    /*
+     * Hilbert curve index of every node by its coordinates, computed at the first call
+     */
+    const std::vector<uint64_t>& get_hilbert_keys() {
+        if (hilbert_keys.size() != coords.size()) {
+            hilbert_keys = HilbertOrder::keys(coords);
+        }
+        return hilbert_keys;
+    }
+
+    void set_graph(igraph_t* g, std::vector<long>& weights) {
+        igraph_copy(&this->graph, g);
+        this->graph_built = true;
+        this->weights = weights;
+        long ecount = igraph_ecount(g);
+        this->edges.resize(2 * ecount);
+        for (long i = 0; i < ecount; i++) {
+            igraph_integer_t from, to;
+            igraph_edge(g, i, &from, &to);
+            this->edges[2*i] = from;
+            this->edges[2*i + 1] = to;
+        }
+        this->csr.build(igraph_vcount(g), this->edges, this->weights);
+        this->component_count = -1;
+    }
+
+    /*
+     * igraph representation of the network, built from the edge list at the first call
+     */
+    igraph_t* get_graph() {
+        if (!graph_built) {
+            igraph_empty(&graph, graph_size(), false);
+            igraph_vector_t edge_vector;
+            igraph_vector_init(&edge_vector, edges.size());
+            for (long i = 0; i < edges.size(); i++) {
+                VECTOR(edge_vector)[i] = edges[i];
+            }
+            igraph_add_edges(&graph, &edge_vector, 0);
+            igraph_vector_destroy(&edge_vector);
+            graph_built = true;
+        }
+        return &graph;
+    }
+
+    void unmap() {
+        if (mapping != nullptr) {
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+        }
     }
 
     long graph_size() {
-        igraph_integer_t vcount = igraph_vcount(&this->graph);
-        return static_cast<long>(vcount);
+        return csr.node_count();
+    }
+
+    /*
+     * Weakly connected components of the network, computed once and cached
+     */
+    long components() {
+        if (component_count < 0) {
+            component_count = csr.weak_components(component_membership);
+        }
+        return component_count;
+    }
+
+    /*
+     * Networks induced by the given weak components, in one pass over the network:
+     * node i of the k-th network is node_ids[k][i] of this one.
+     * Customers keep their relative order, potential facilities and their capacities are kept if in the component
+     */
+    std::vector<Network*> extract_components(const std::vector<long>& component_ids,
+                                             std::vector<std::vector<long>>& node_ids) {
+        this->components();
+        std::vector<long> slot(component_count, -1);
+        std::vector<Network*> result(component_ids.size());
+        node_ids.assign(component_ids.size(), std::vector<long>());
+        for (long k = 0; k < component_ids.size(); k++) {
+            slot[component_ids[k]] = k;
+            result[k] = new Network();
+            result[k]->id = this->id + "_" + std::to_string(component_ids[k]);
+        }
+        std::vector<long> local_id(graph_size(), -1);
+        for (long i = 0; i < graph_size(); i++) {
+            long k = slot[component_membership[i]];
+            if (k != -1) {
+                local_id[i] = node_ids[k].size();
+                node_ids[k].push_back(i);
+            }
+        }
+        for (long i = 0; i < weights.size(); i++) {
+            long k = slot[component_membership[edges[2*i]]];
+            if (k != -1) {
+                result[k]->edges.push_back(local_id[edges[2*i]]);
+                result[k]->edges.push_back(local_id[edges[2*i + 1]]);
+                result[k]->weights.push_back(weights[i]);
+            }
+        }
+        for (long i = 0; i < source_indexes.size(); i++) {
+            long k = slot[component_membership[source_indexes[i]]];
+            if (k != -1) {
+                result[k]->source_indexes.push_back(local_id[source_indexes[i]]);
+            }
+        }
+        for (long i = 0; i < target_indexes.size(); i++) {
+            long k = slot[component_membership[target_indexes[i]]];
+            if (k != -1) {
+                result[k]->target_indexes.push_back(local_id[target_indexes[i]]);
+                if (target_capacities.size() > 0) {
+                    result[k]->target_capacities.push_back(target_capacities[i]);
+                }
+            }
+        }
+        for (long k = 0; k < result.size(); k++) {
+            Network* component = result[k];
+            component->csr.build(node_ids[k].size(), component->edges, component->weights);
+            if (coords.size() == graph_size()) {
+                for (long i = 0; i < node_ids[k].size(); i++) {
+                    component->coords.push_back(coords[node_ids[k][i]]);
+                }
+            }
+            component->component_membership.assign(node_ids[k].size(), 0);
+            component->component_count = 1;
+        }
+        return result;
     }
 
     long number_of_customers() {
@@ -77,20 +281,24 @@ public:
     }
 
     void save(std::string dir, std::string filename) {
+        if (has_extension(filename, NTWB_EXTENSION)) {
+            this->save_binary_file(filename);
+            return;
+        }
+        long vcount = graph_size();
+        long ecount = weights.size();
         std::ofstream outf(filename,std::ios::out);
         outf << this->id << " "
-             << igraph_vcount(&graph) << " "
-             << igraph_ecount(&graph) << " "
+             << vcount << " "
+             << ecount << " "
              << source_indexes.size() << "\n";
-        for (long i = 0; i < igraph_ecount(&graph); i++) {
-            igraph_integer_t from, to;
-            igraph_edge(&graph, i, &from, &to);
-            outf << from << " " << to << " " << weights[i] << "\n";
+        for (long i = 0; i < ecount; i++) {
+            outf << edges[2*i] << " " << edges[2*i + 1] << " " << weights[i] << "\n";
         }
         for (long i = 0; i < source_indexes.size(); i++) {
             outf << source_indexes[i] << "\n";
         }
-        for (long i = 0; i < igraph_vcount(&graph); i++) {
+        for (long i = 0; i < vcount; i++) {
             outf << coords[i].first << " " << coords[i].second << "\n";
         }
         outf.close();
@@ -101,30 +309,309 @@ public:
         this->save(dir, filename);
     }
 
+    void save_binary(std::string dir) {
+        std::string filename = dir + '/' + this->id + NTWB_EXTENSION;
+        this->save(dir, filename);
+    }
+
+    static inline uint64_t align8(uint64_t offset) {
+        return (offset + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    /*
+     * Write the network in .ntwb format. CSR and components are stored unless with_index is false,
+     * potential facilities only if they were given explicitly (capacities are set).
+     */
+    void save_binary_file(std::string filename, bool with_index = true) {
+        if (csr.has_multiple_edges()) {
+            //same restriction as in load_text, files are not checked again when they are mapped
+            throw std::invalid_argument("Graph has multiple edges");
+        }
+        NtwbHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, NTWB_MAGIC, 4);
+        header.version = NTWB_VERSION;
+        header.id_length = id.size();
+        header.node_count = graph_size();
+        header.edge_count = weights.size();
+        header.source_count = source_indexes.size();
+        bool with_targets = target_capacities.size() > 0;
+        if (with_targets) {
+            header.flags |= NTWB_HAS_TARGETS;
+            header.target_count = target_indexes.size();
+        }
+        if (coords.size() >= header.node_count) {
+            header.flags |= NTWB_HAS_COORDS;
+        }
+        if (with_index) {
+            header.flags |= NTWB_HAS_CSR | NTWB_HAS_COMPONENTS;
+            header.component_count = components();
+        }
+
+        //layout of columns
+        uint64_t offset = align8(sizeof(NtwbHeader));
+        header.id_offset = offset;
+        offset = align8(offset + id.size());
+        header.edges_offset = offset;
+        offset += 2 * header.edge_count * sizeof(int64_t);
+        header.weights_offset = offset;
+        offset += header.edge_count * sizeof(int64_t);
+        header.sources_offset = offset;
+        offset += header.source_count * sizeof(int64_t);
+        if (header.flags & NTWB_HAS_COORDS) {
+            header.coords_offset = offset;
+            offset += 2 * header.node_count * sizeof(double);
+        }
+        if (with_targets) {
+            header.targets_offset = offset;
+            offset += header.target_count * sizeof(int64_t);
+            header.capacities_offset = offset;
+            offset += header.target_count * sizeof(int64_t);
+        }
+        if (with_index) {
+            header.csr_offsets_offset = offset;
+            offset += (header.node_count + 1) * sizeof(int64_t);
+            header.csr_arcs_offset = offset;
+            offset += 2 * header.edge_count * sizeof(CSRGraph::Arc);
+            header.components_offset = offset;
+            offset += header.node_count * sizeof(int64_t);
+        }
+
+        std::ofstream outf(filename, std::ios::out | std::ios::binary);
+        if (!outf) {
+            throw std::invalid_argument("Can not open output file " + filename);
+        }
+        write_column(outf, header.id_offset, id.data(), id.size());
+        std::vector<int64_t> column(edges.begin(), edges.end());
+        write_column(outf, header.edges_offset, column.data(), column.size() * sizeof(int64_t));
+        column.assign(weights.begin(), weights.end());
+        write_column(outf, header.weights_offset, column.data(), column.size() * sizeof(int64_t));
+        column.assign(source_indexes.begin(), source_indexes.end());
+        write_column(outf, header.sources_offset, column.data(), column.size() * sizeof(int64_t));
+        if (header.flags & NTWB_HAS_COORDS) {
+            std::vector<double> xy(2 * header.node_count);
+            for (long i = 0; i < header.node_count; i++) {
+                xy[2*i] = coords[i].first;
+                xy[2*i + 1] = coords[i].second;
+            }
+            write_column(outf, header.coords_offset, xy.data(), xy.size() * sizeof(double));
+        }
+        if (with_targets) {
+            column.assign(target_indexes.begin(), target_indexes.end());
+            write_column(outf, header.targets_offset, column.data(), column.size() * sizeof(int64_t));
+            column.assign(target_capacities.begin(), target_capacities.end());
+            write_column(outf, header.capacities_offset, column.data(), column.size() * sizeof(int64_t));
+        }
+        if (with_index) {
+            write_column(outf, header.csr_offsets_offset, csr.offset_view, (header.node_count + 1) * sizeof(long));
+            write_column(outf, header.csr_arcs_offset, csr.arc_view, 2 * header.edge_count * sizeof(CSRGraph::Arc));
+            column.assign(component_membership.begin(), component_membership.end());
+            write_column(outf, header.components_offset, column.data(), column.size() * sizeof(int64_t));
+        }
+        outf.seekp(0);
+        outf.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outf.close();
+    }
+
+    static void write_column(std::ofstream& outf, uint64_t offset, const void* data, size_t bytes) {
+        outf.seekp(offset);
+        outf.write(reinterpret_cast<const char*>(data), bytes);
+    }
+
+    /*
+     * Map a .ntwb file. CSR is used directly from the mapping if it is stored, other columns are copied
+     * without parsing. The multiple-edges check is done when the file is written, here only the layout is checked:
+     * every column has to lie inside the file and node ids have to be in range.
+     */
+    void load_binary(std::string filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::invalid_argument("Input file does not exist");
+        }
+        struct stat file_stat;
+        fstat(fd, &file_stat);
+        if (file_stat.st_size < sizeof(NtwbHeader)) {
+            close(fd);
+            throw std::invalid_argument("File is too short for a binary network");
+        }
+        unmap();
+        mapping_size = file_stat.st_size;
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error("Can not map " + filename);
+        }
+        const char* base = static_cast<const char*>(mapping);
+        NtwbHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, NTWB_MAGIC, 4) != 0 || header.version != NTWB_VERSION) {
+            unmap();
+            throw std::invalid_argument("Unsupported binary network format");
+        }
+        check_binary_layout(header);
+
+        this->id = std::string(base + header.id_offset, header.id_length);
+        const int64_t* edge_column = reinterpret_cast<const int64_t*>(base + header.edges_offset);
+        this->edges.assign(edge_column, edge_column + 2 * header.edge_count);
+        const int64_t* weight_column = reinterpret_cast<const int64_t*>(base + header.weights_offset);
+        this->weights.assign(weight_column, weight_column + header.edge_count);
+        const int64_t* source_column = reinterpret_cast<const int64_t*>(base + header.sources_offset);
+        this->source_indexes.assign(source_column, source_column + header.source_count);
+
+        this->coords.clear();
+        this->hilbert_keys.clear();
+        if (header.flags & NTWB_HAS_COORDS) {
+            const double* xy = reinterpret_cast<const double*>(base + header.coords_offset);
+            this->coords.resize(header.node_count);
+            for (long i = 0; i < header.node_count; i++) {
+                this->coords[i] = std::make_pair(xy[2*i], xy[2*i + 1]);
+            }
+        } else {
+            this->coords.resize(header.node_count);
+        }
+
+        if (!node_ids_in_range(this->edges, header.node_count) ||
+            !node_ids_in_range(this->source_indexes, header.node_count)) {
+            unmap();
+            throw std::invalid_argument("Binary network refers to nodes out of range");
+        }
+
+        if (header.flags & NTWB_HAS_CSR) {
+            csr.attach(reinterpret_cast<const long*>(base + header.csr_offsets_offset),
+                       reinterpret_cast<const CSRGraph::Arc*>(base + header.csr_arcs_offset),
+                       header.node_count);
+        } else {
+            csr.build(header.node_count, this->edges, this->weights);
+        }
+        if (header.flags & NTWB_HAS_COMPONENTS) {
+            const int64_t* component_column = reinterpret_cast<const int64_t*>(base + header.components_offset);
+            this->component_membership.assign(component_column, component_column + header.node_count);
+            this->component_count = header.component_count;
+        } else {
+            this->component_count = -1;
+        }
+
+        target_indexes.clear();
+        target_capacities.clear();
+        if (header.flags & NTWB_HAS_TARGETS) {
+            const int64_t* target_column = reinterpret_cast<const int64_t*>(base + header.targets_offset);
+            const int64_t* capacity_column = reinterpret_cast<const int64_t*>(base + header.capacities_offset);
+            target_indexes.assign(target_column, target_column + header.target_count);
+            target_capacities.assign(capacity_column, capacity_column + header.target_count);
+            if (!node_ids_in_range(target_indexes, header.node_count)) {
+                unmap();
+                throw std::invalid_argument("Binary network refers to nodes out of range");
+            }
+        }
+        if (!(header.flags & NTWB_HAS_CSR)) {
+            //index is not needed anymore, keep memory only while csr points into it
+            unmap();
+        }
+    }
+
+    /*
+     * Columns of a mapped header within the mapping, throws and unmaps otherwise
+     */
+    void check_binary_layout(const NtwbHeader& header) {
+        bool valid = header.node_count >= 0 && header.edge_count >= 0 && header.source_count >= 0 &&
+                     header.target_count >= 0;
+        valid = valid && fits_mapping(header.id_offset, header.id_length, 1);
+        valid = valid && fits_mapping(header.edges_offset, 2 * header.edge_count, sizeof(int64_t));
+        valid = valid && fits_mapping(header.weights_offset, header.edge_count, sizeof(int64_t));
+        valid = valid && fits_mapping(header.sources_offset, header.source_count, sizeof(int64_t));
+        if (header.flags & NTWB_HAS_COORDS) {
+            valid = valid && fits_mapping(header.coords_offset, 2 * header.node_count, sizeof(double));
+        }
+        if (header.flags & NTWB_HAS_TARGETS) {
+            valid = valid && fits_mapping(header.targets_offset, header.target_count, sizeof(int64_t));
+            valid = valid && fits_mapping(header.capacities_offset, header.target_count, sizeof(int64_t));
+        }
+        if (header.flags & NTWB_HAS_CSR) {
+            valid = valid && fits_mapping(header.csr_offsets_offset, header.node_count + 1, sizeof(int64_t));
+            valid = valid && fits_mapping(header.csr_arcs_offset, 2 * header.edge_count, sizeof(CSRGraph::Arc));
+            if (valid) {
+                //arcs of the mapped index are addressed through its offsets and lead to nodes
+                const int64_t* offsets = reinterpret_cast<const int64_t*>(
+                        static_cast<const char*>(mapping) + header.csr_offsets_offset);
+                valid = offsets[0] == 0 && offsets[header.node_count] == 2 * header.edge_count;
+                for (int64_t v = 0; v < header.node_count && valid; v++) {
+                    valid = offsets[v] <= offsets[v + 1];
+                }
+                const CSRGraph::Arc* arcs = reinterpret_cast<const CSRGraph::Arc*>(
+                        static_cast<const char*>(mapping) + header.csr_arcs_offset);
+                for (int64_t a = 0; a < 2 * header.edge_count && valid; a++) {
+                    valid = arcs[a].target >= 0 && arcs[a].target < header.node_count;
+                }
+            }
+        }
+        if (header.flags & NTWB_HAS_COMPONENTS) {
+            valid = valid && fits_mapping(header.components_offset, header.node_count, sizeof(int64_t));
+        }
+        if (!valid) {
+            unmap();
+            throw std::invalid_argument("Binary network is truncated or corrupt");
+        }
+    }
+
+    /*
+     * <count> elements of <size> bytes at <offset> lie inside the mapping, numeric columns are 8-byte aligned
+     */
+    bool fits_mapping(uint64_t offset, int64_t count, uint64_t size) const {
+        if (offset < sizeof(NtwbHeader) || offset > mapping_size || (size > 1 && offset % 8 != 0)) {
+            return false;
+        }
+        return count >= 0 && (uint64_t) count <= (mapping_size - offset) / size;
+    }
+
+    static bool node_ids_in_range(const std::vector<long>& ids, int64_t node_count) {
+        for (long i = 0; i < ids.size(); i++) {
+            if (ids[i] < 0 || ids[i] >= node_count) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     void load(std::string filename, std::string target_list_filename = "") {
+        delete ch; //hierarchy of a previous graph
+        ch = nullptr;
+        if (has_extension(filename, NTWB_EXTENSION)) {
+            this->load_binary(filename);
+        } else {
+            this->load_text(filename);
+        }
+        if (target_list_filename != "") {
+            this->load_targets(target_list_filename);
+        } else if (target_capacities.size() == 0) {
+            target_indexes.clear();
+            for (long i = 0; i < graph_size(); i++) {
+                target_indexes.push_back(i);
+            }
+        }
+    }
+
+    void load_text(std::string filename) {
         std::ifstream infile(filename, std::ios::in);
         if (!infile) {
             throw std::invalid_argument("Input file does not exist");
         }
         long vcount, ecount, source_num;
         infile >> this->id >> vcount >> ecount >> source_num;
-        igraph_empty(&graph, vcount, false);
-        igraph_vector_t edges;
-        igraph_vector_init(&edges, ecount*2);
+        edges.resize(ecount*2);
         weights.clear();
         weights.reserve(ecount);
         for (long i = 0; i < ecount; i++) {
-            long from, to, weight, capacity;
+            long from, to, weight;
             infile >> from >> to >> weight;
-            VECTOR(edges)[2*i] = from;
-            VECTOR(edges)[2*i + 1] = to;
+            edges[2*i] = from;
+            edges[2*i + 1] = to;
             weights.push_back(weight);
         }
-        igraph_add_edges(&this->graph, &edges, 0);
+        csr.build(vcount, edges, weights);
+        component_count = -1;
 
-        igraph_bool_t check_multiple;
-        igraph_has_multiple(&this->graph, &check_multiple);
-        if (check_multiple) {
+        if (csr.has_multiple_edges()) {
             std::cout << "Graph has multiple edges" << std::endl; //@todo move this
             //is not allowed because in facility choser when covering is checked
             //we assume that every outgoing edge from a facility covers one unique new customer
@@ -138,42 +625,30 @@ public:
             infile >> source_id;
             source_indexes.push_back(source_id);
         }
+        coords.clear();
+        hilbert_keys.clear();
         for (long i = 0; i < vcount; i++) {
             double x,y;
             infile >> x >> y;
             coords.push_back(std::make_pair(x,y));
         }
+        target_indexes.clear();
+        target_capacities.clear();
+    }
 
-        //check if consistent
-//        for (long i = 0; i < ecount; i++) {
-//            igraph_integer_t from;
-//            igraph_integer_t to;
-//            igraph_edge(&graph, i, &from, &to);
-//            if ((from != VECTOR(edges)[2*i]) || (to != VECTOR(edges)[2*i+1])) {
-//                throw "not valid";
-//            }
-//        }
-        igraph_vector_destroy(&edges);
+    void load_targets(std::string target_list_filename) {
         target_indexes.clear();
         target_capacities.clear();
-        if (target_list_filename != "") {
-	        std::ifstream target_list_file(target_list_filename.c_str());
-           //@todo wtf check for a file does not work 
-            long nodeid, capacity;
-            while (target_list_file >> nodeid >> capacity) {
-                target_indexes.push_back(nodeid);
-                target_capacities.push_back(capacity);
-            }
-            if (target_capacities.size() == 0) {
-                std::cout << "Error file with potential facilities is empty" << std::endl;
-                //throw std::string("File with potential facilities is empty");
-	        }
-        } else {
-            target_indexes.clear();
-            for (long i = 0; i < vcount; i++) {
-                target_indexes.push_back(i);
-            }
-            target_capacities.clear();
+        std::ifstream target_list_file(target_list_filename.c_str());
+        //@todo wtf check for a file does not work
+        long nodeid, capacity;
+        while (target_list_file >> nodeid >> capacity) {
+            target_indexes.push_back(nodeid);
+            target_capacities.push_back(capacity);
+        }
+        if (target_capacities.size() == 0) {
+            std::cout << "Error file with potential facilities is empty" << std::endl;
+            //throw std::string("File with potential facilities is empty");
         }
     }
 
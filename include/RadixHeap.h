@@ -0,0 +1,161 @@
+/*
+ * Radix heap for monotone integer priority queues (Dijkstra with non-negative integer weights):
+ * a key can not be smaller than the last dequeued key. It provides the same interface as fHeap.
+ *
+ * Elements are kept in buckets by the highest bit in which their key differs from the last dequeued key,
+ * so each element is moved at most once per bit. Decrease-key pushes a new entry, entries that do not hold
+ * the current value of their element are dropped when they are reached.
+ */
+
+#ifndef FCLA_RADIXHEAP_H
+#define FCLA_RADIXHEAP_H
+
+#include <vector>
+#include <cstdint>
+
+template <class V, class I>
+class RadixHeap {
+public:
+    static const int BUCKETS = 65;
+
+    struct elem {
+        V value;
+        I idx;
+    };
+
+    std::vector<elem> buckets[BUCKETS];
+    std::vector<V> value; //current value per element
+    std::vector<bool> queued;
+    V last = 0;
+    I count = 0; //number of queued elements, not entries
+
+    RadixHeap() {}
+
+    void clear() {
+        for (int b = 0; b < BUCKETS; b++) {
+            for (I i = 0; i < buckets[b].size(); i++) {
+                queued[buckets[b][i].idx] = false;
+            }
+            buckets[b].clear();
+        }
+        last = 0;
+        count = 0;
+    }
+
+    inline I size() const {
+        return count;
+    }
+
+    inline int bucketOf(V key) const {
+        uint64_t diff = static_cast<uint64_t>(key) ^ static_cast<uint64_t>(last);
+        return diff == 0 ? 0 : 64 - __builtin_clzll(diff);
+    }
+
+    inline bool isExisted(I idx) const {
+        return idx < queued.size() && queued[idx];
+    }
+
+    inline V getVal(I idx) const {
+        return value[idx];
+    }
+
+    inline bool isCurrent(const elem& e) const {
+        return queued[e.idx] && value[e.idx] == e.value;
+    }
+
+    void enqueue(I idx, V new_val) {
+        if (idx >= value.size()) {
+            value.resize(idx + 1);
+            queued.resize(idx + 1, false);
+        }
+        value[idx] = new_val;
+        queued[idx] = true;
+        count++;
+        buckets[bucketOf(new_val)].push_back({new_val, idx});
+    }
+
+    void updatequeue(I idx, V new_val) {
+        if (new_val == value[idx]) {
+            return;
+        }
+        value[idx] = new_val;
+        buckets[bucketOf(new_val)].push_back({new_val, idx});
+    }
+
+    bool updateorenqueue(I idx, V new_val) {
+        if (isExisted(idx)) {
+            updatequeue(idx, new_val);
+            return true;
+        }
+        enqueue(idx, new_val);
+        return false;
+    }
+
+    /*
+     * Make bucket 0 hold the current minimum: redistribute the first non-empty bucket around its minimum
+     */
+    bool pull() {
+        while (true) {
+            while (buckets[0].size() > 0 && !isCurrent(buckets[0].back())) {
+                buckets[0].pop_back();
+            }
+            if (buckets[0].size() > 0) {
+                return true;
+            }
+            int b = 1;
+            while (b < BUCKETS && buckets[b].size() == 0) {
+                b++;
+            }
+            if (b == BUCKETS) {
+                return false;
+            }
+            bool found = false;
+            V minimum = 0;
+            for (I i = 0; i < buckets[b].size(); i++) {
+                if (isCurrent(buckets[b][i]) && (!found || buckets[b][i].value < minimum)) {
+                    minimum = buckets[b][i].value;
+                    found = true;
+                }
+            }
+            if (found) {
+                last = minimum;
+                for (I i = 0; i < buckets[b].size(); i++) {
+                    if (isCurrent(buckets[b][i])) {
+                        buckets[bucketOf(buckets[b][i].value)].push_back(buckets[b][i]);
+                    }
+                }
+            }
+            buckets[b].clear();
+        }
+    }
+
+    bool dequeue(I &idx, V &val) {
+        if (count == 0 || !pull()) {
+            return false;
+        }
+        elem e = buckets[0].back();
+        buckets[0].pop_back();
+        idx = e.idx;
+        val = e.value;
+        queued[idx] = false;
+        count--;
+        return true;
+    }
+
+    I dequeue(I &idx) {
+        V val;
+        return dequeue(idx, val) ? 1 : 0;
+    }
+
+    V getTopValue() {
+        pull();
+        return buckets[0].back().value;
+    }
+
+    I getTopIdx() {
+        pull();
+        return buckets[0].back().idx;
+    }
+};
+
+#endif //FCLA_RADIXHEAP_H
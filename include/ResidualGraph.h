@@ -0,0 +1,173 @@
+/*
+ * Residual bipartite graph of the matcher: adjacency lists of (target, weight) edges.
+ *
+ * Edge records live in one slab and are linked into doubly-linked lists of their nodes by indexes, removed records
+ * are reused through a free list. An edge is addressed by a stable handle (its slab index), so it can be removed
+ * or flipped to the opposite direction in O(1) without scanning the list of its node.
+ * New edges are added in front, the order of a list is the same as with std::forward_list::push_front.
+ * Every change of a list increments the version of its node, so that derived data can be refreshed selectively.
+ */
+
+#ifndef FCLA_RESIDUALGRAPH_H
+#define FCLA_RESIDUALGRAPH_H
+
+#include <vector>
+#include <utility>
+
+template<typename I, typename W>
+class ResidualGraph {
+public:
+    typedef std::pair<I,W> Edge;
+
+    struct Record {
+        Edge edge;
+        I owner; //node whose list contains the record
+        I prev;
+        I next;
+    };
+
+    std::vector<Record> slab;
+    std::vector<I> head; //first record of each node, -1 if the list is empty
+    std::vector<I> list_size;
+    std::vector<unsigned> version; //incremented on every change of a list
+    unsigned generation = 0; //incremented on reset, versions are comparable within one generation
+    I free_head = -1;
+
+    class iterator {
+    public:
+        Record* records;
+        I position;
+
+        iterator(Record* records, I position) : records(records), position(position) {}
+        inline Edge& operator*() const { return records[position].edge; }
+        inline Edge* operator->() const { return &records[position].edge; }
+        inline iterator& operator++() {
+            position = records[position].next;
+            return *this;
+        }
+        inline iterator operator++(int) {
+            iterator current = *this;
+            position = records[position].next;
+            return current;
+        }
+        inline bool operator==(const iterator& other) const { return position == other.position; }
+        inline bool operator!=(const iterator& other) const { return position != other.position; }
+        //handle of the edge
+        inline I handle() const { return position; }
+    };
+
+    /*
+     * Adjacency list of one node
+     */
+    class NodeList {
+    public:
+        ResidualGraph* graph;
+        I node;
+
+        NodeList(ResidualGraph* graph, I node) : graph(graph), node(node) {}
+        inline iterator begin() const { return iterator(graph->slab.data(), graph->head[node]); }
+        inline iterator end() const { return iterator(graph->slab.data(), -1); }
+        inline Edge& front() const { return graph->slab[graph->head[node]].edge; }
+        inline bool empty() const { return graph->head[node] == -1; }
+        inline I size() const { return graph->list_size[node]; }
+        inline I push_front(const Edge& edge) const { return graph->push_front(node, edge.first, edge.second); }
+        inline void clear() const { graph->clear(node); }
+    };
+
+    ResidualGraph() {}
+
+    inline NodeList operator[](I node) {
+        return NodeList(this, node);
+    }
+
+    inline I size() const {
+        return head.size();
+    }
+
+    /*
+     * Remove all edges and set the number of nodes
+     */
+    void reset(I node_count) {
+        slab.clear();
+        head.assign(node_count, -1);
+        list_size.assign(node_count, 0);
+        version.assign(node_count, 0);
+        generation++;
+        free_head = -1;
+    }
+
+    I allocate() {
+        if (free_head != -1) {
+            I handle = free_head;
+            free_head = slab[handle].next;
+            return handle;
+        }
+        slab.push_back(Record());
+        return slab.size() - 1;
+    }
+
+    void link_front(I node, I handle) {
+        Record& record = slab[handle];
+        record.owner = node;
+        record.prev = -1;
+        record.next = head[node];
+        if (head[node] != -1) {
+            slab[head[node]].prev = handle;
+        }
+        head[node] = handle;
+        list_size[node]++;
+        version[node]++;
+    }
+
+    void unlink(I handle) {
+        Record& record = slab[handle];
+        if (record.prev != -1) {
+            slab[record.prev].next = record.next;
+        } else {
+            head[record.owner] = record.next;
+        }
+        if (record.next != -1) {
+            slab[record.next].prev = record.prev;
+        }
+        list_size[record.owner]--;
+        version[record.owner]++;
+    }
+
+    I push_front(I node, I target, W weight) {
+        I handle = allocate();
+        slab[handle].edge = Edge(target, weight);
+        link_front(node, handle);
+        return handle;
+    }
+
+    void erase(I handle) {
+        unlink(handle);
+        slab[handle].next = free_head;
+        free_head = handle;
+    }
+
+    /*
+     * Turn an edge owner->target into target->owner with the opposite weight, the record is reused
+     */
+    I flip(I handle) {
+        unlink(handle);
+        Record& record = slab[handle];
+        I source = record.owner;
+        I target = record.edge.first;
+        record.edge = Edge(source, -record.edge.second);
+        link_front(target, handle);
+        return handle;
+    }
+
+    inline I owner(I handle) const {
+        return slab[handle].owner;
+    }
+
+    void clear(I node) {
+        while (head[node] != -1) {
+            erase(head[node]);
+        }
+    }
+};
+
+#endif //FCLA_RESIDUALGRAPH_H
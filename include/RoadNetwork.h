@@ -23,6 +23,7 @@ public:
     igraph_t graph;
     std::vector<long> weights;
     std::vector<Tags> node_tags;
+    bool keep_tags = false; //keep node tags and edge types of OSM for save_with_tag
     Visitor* v;
 
     RoadNetwork() {
@@ -39,11 +40,15 @@ public:
         igraph_destroy(&graph);
     };
 
-    void load_pbf(std::string path) {
+    //two passes over the file: highway ways, then only the nodes they reference. blobs are decoded by <threads>
+    void load_pbf(std::string path, unsigned threads = 1) {
         v = new Visitor();
-        read_osm_pbf(path, *v);
+        v->keep_tags = keep_tags;
+        read_osm_pbf(path, *v, threads);
+        v->collect_nodes();
+        read_osm_pbf(path, *v, threads);
         v->set_graph(&graph);
-        this->node_tags = v->node_tags;
+        this->node_tags.swap(v->node_tags);
     }
 
     //get euclidean coordinates out of
@@ -111,7 +116,7 @@ public:
     }
 
     //saves network with random selected source nodes
-    void save_network(std::string outdir, long source_num) {
+    void save_network(std::string outdir, long source_num, bool binary = false) {
         std::vector<long> weights;
         std::vector<long> indexes;
 
@@ -129,7 +134,11 @@ public:
             coords.push_back(std::make_pair(x1,y1));
         }
         Network net(&this->graph, this->weights, source_index, coords);
-        net.save(outdir);
+        if (binary) {
+            net.save_binary(outdir);
+        } else {
+            net.save(outdir);
+        }
     }
 
     std::string merge_tags(Tags tags) {
@@ -165,10 +174,10 @@ public:
         for (long i = 0; i < igraph_ecount(&graph); i++) {
             igraph_integer_t from, to;
             igraph_edge(&graph, i, &from, &to);
-            outf << from << " " << to << " " << weights[i] << " " << v->edge_type[i] << "\n";
+            outf << from << " " << to << " " << weights[i] << " " << (keep_tags ? v->edge_type[i] : "") << "\n";
         }
         for (long i = 0; i < igraph_vcount(&graph); i++) {
-            outf << coords[i].first << " " << coords[i].second << " " << merge_tags(node_tags[i]) << "\n";
+            outf << coords[i].first << " " << coords[i].second << " " << (keep_tags ? merge_tags(node_tags[i]) : "") << "\n";
         }
         outf.close();
     }
@@ -0,0 +1,246 @@
+/*
+ * Lazy greedy set cover of customers by facilities they are matched to, persistent between capacity iterations.
+ *
+ * Customers matched to a facility are copied from the residual graph into a contiguous array, and copied again
+ * only if the residual list of the facility has changed since (ResidualGraph versions). During a run, uncovered
+ * customers of a facility are kept in front of its array: covered ones are swapped behind the live part,
+ * so arrays are never reallocated.
+ *
+ * Facilities wait in bucket queues keyed by their coverage (number of uncovered customers). The top facility is
+ * selected if its coverage is still exact, otherwise it is moved to the bucket of its actual coverage.
+ * Among facilities with the same coverage the least recently selected one goes first.
+ *
+ * On dense matchings coverage is counted over bitsets instead: a row of customer bits per facility and a bitset
+ * of covered customers, AND-NOT and popcount by BitsetKernels. Arrays are used while the matching is sparse.
+ */
+
+#ifndef FCLA_SETCOVER_H
+#define FCLA_SETCOVER_H
+
+#include <vector>
+#include <algorithm>
+#include "ResidualGraph.h"
+#include "BitsetKernels.h"
+
+template<typename I, typename W>
+class SetCover {
+public:
+    std::vector<std::vector<I>> members; //customers matched to a facility
+    std::vector<I> live; //members[f][0..live[f]) are not covered in the current run
+    std::vector<unsigned> seen_version; //version of the residual list when members were copied
+    unsigned seen_generation = 0;
+    bool initialized = false;
+
+    std::vector<std::vector<I>> buckets; //facilities by coverage, each a heap with the least recent one on top
+    std::vector<I> recency; //facilities from the most to the least recently selected
+    std::vector<I> recency_rank; //position of a facility in recency
+    std::vector<bool> selected_flag;
+
+    //bitsets are used if the fraction of matched customers per facility is at least <bitset_min_density>,
+    //without hardware popcount never by default
+    double bitset_min_density = bitset_kernels_are_fast() ? 1.0 / 64 : 2;
+    bool use_bitsets = false;
+    long words = 0; //per bitset
+    std::vector<uint64_t> rows; //customers of facility f in rows[f*words..(f+1)*words)
+    std::vector<unsigned> row_version; //version of members a row was built from
+    std::vector<bool> row_valid;
+    std::vector<uint64_t> covered_bits;
+
+    std::vector<long> covered; //per customer
+    long total_covered = 0;
+    long max_coverage = 0;
+    I source_count = 0;
+
+    SetCover() {}
+
+    /*
+     * Refresh member arrays of facilities whose residual lists have changed, return the number of refreshed ones.
+     * Facility f is node <first_facility_node> + f of the residual graph
+     */
+    I update(ResidualGraph<I,W>& edges, I source_count, I first_facility_node, I facility_count) {
+        if (!initialized || edges.generation != seen_generation || members.size() != facility_count) {
+            members.assign(facility_count, std::vector<I>());
+            seen_version.assign(facility_count, 0);
+            recency.resize(facility_count);
+            recency_rank.resize(facility_count);
+            for (I f = 0; f < facility_count; f++) {
+                recency[f] = facility_count - 1 - f;
+            }
+            selected_flag.assign(facility_count, false);
+            //versions of a new generation start over and may repeat those the rows were built from
+            row_valid.assign(row_valid.size(), false);
+            seen_generation = edges.generation;
+            initialized = true;
+            for (I f = 0; f < facility_count; f++) {
+                seen_version[f] = edges.version[first_facility_node + f] - 1; //force copy
+            }
+        }
+        this->source_count = source_count;
+        covered.resize(source_count);
+        live.resize(facility_count);
+        I refreshed = 0;
+        long total_members = 0;
+        for (I f = 0; f < facility_count; f++) {
+            total_members += edges[first_facility_node + f].size();
+            I node = first_facility_node + f;
+            if (edges.version[node] == seen_version[f]) {
+                continue;
+            }
+            members[f].clear();
+            for (auto it = edges[node].begin(); it != edges[node].end(); it++) {
+                members[f].push_back(it->first);
+            }
+            seen_version[f] = edges.version[node];
+            refreshed++;
+        }
+        use_bitsets = total_members >= bitset_min_density * (double) facility_count * (double) source_count;
+        if (use_bitsets) {
+            updateRows();
+        }
+        return refreshed;
+    }
+
+    /*
+     * Rebuild bitset rows of facilities whose members were copied since the row was built
+     */
+    void updateRows() {
+        I facility_count = members.size();
+        if (words != bitset_words(source_count) || row_valid.size() != facility_count) {
+            words = bitset_words(source_count);
+            rows.assign(facility_count * words, 0);
+            row_version.assign(facility_count, 0);
+            row_valid.assign(facility_count, false);
+        }
+        covered_bits.resize(words);
+        for (I f = 0; f < facility_count; f++) {
+            if (row_valid[f] && row_version[f] == seen_version[f]) {
+                continue;
+            }
+            uint64_t* row = rows.data() + f * words;
+            std::fill(row, row + words, 0);
+            for (I i = 0; i < members[f].size(); i++) {
+                bitset_set(row, members[f][i]);
+            }
+            row_version[f] = seen_version[f];
+            row_valid[f] = true;
+        }
+    }
+
+    /*
+     * Uncovered customers of a facility after moving covered ones behind the live part
+     */
+    I recount(I f) {
+        if (use_bitsets) {
+            live[f] = bitset_count_andnot(rows.data() + f * words, covered_bits.data(), words);
+            return live[f];
+        }
+        std::vector<I>& customers = members[f];
+        I size = live[f];
+        I i = 0;
+        while (i < size) {
+            if (covered[customers[i]]) {
+                size--;
+                std::swap(customers[i], customers[size]);
+            } else {
+                i++;
+            }
+        }
+        live[f] = size;
+        return size;
+    }
+
+    /*
+     * Select facilities greedily until no facility covers a new customer or more than <max_selected> are selected
+     * (the last one is still added to <result>). Returns true if all customers are covered
+     */
+    bool run(long max_selected, std::vector<long>& result) {
+        std::fill(covered.begin(), covered.end(), 0);
+        std::fill(covered_bits.begin(), covered_bits.end(), 0);
+        total_covered = 0;
+        max_coverage = 0;
+        for (I f = 0; f < members.size(); f++) {
+            live[f] = members[f].size();
+            max_coverage = std::max(max_coverage, (long) live[f]);
+        }
+        if (members.size() == 0) {
+            return false;
+        }
+        for (I c = 0; c < buckets.size(); c++) {
+            buckets[c].clear();
+        }
+        if (buckets.size() < max_coverage + 1) {
+            buckets.resize(max_coverage + 1);
+        }
+        //pushed from the least recently selected facility on, a bucket is sorted by decreasing rank, that is a heap
+        for (I k = recency.size(); k > 0; k--) {
+            recency_rank[recency[k - 1]] = k - 1;
+            buckets[live[recency[k - 1]]].push_back(recency[k - 1]);
+        }
+        auto more_recent = [this](I a, I b) { return this->recency_rank[a] < this->recency_rank[b]; };
+
+        std::vector<I> selected;
+        I top = max_coverage;
+        while (true) {
+            while (top > 0 && buckets[top].size() == 0) {
+                top--;
+            }
+            if (top == 0) {
+                break; //no facility covers a new customer
+            }
+            std::pop_heap(buckets[top].begin(), buckets[top].end(), more_recent);
+            I f = buckets[top].back();
+            buckets[top].pop_back();
+            I coverage = recount(f);
+            if (coverage != top) {
+                //behind facilities of that coverage that were selected less recently
+                buckets[coverage].push_back(f);
+                std::push_heap(buckets[coverage].begin(), buckets[coverage].end(), more_recent);
+                continue;
+            }
+            result.push_back(f);
+            if (result.size() > max_selected) {
+                break;
+            }
+            selected.push_back(f);
+            if (use_bitsets) {
+                bitset_or(covered_bits.data(), rows.data() + f * words, words);
+            } else {
+                for (I i = 0; i < coverage; i++) {
+                    covered[members[f][i]]++;
+                }
+            }
+            total_covered += coverage;
+        }
+        if (use_bitsets) {
+            for (I c = 0; c < source_count; c++) {
+                covered[c] = bitset_test(covered_bits.data(), c);
+            }
+        }
+        updateRecency(selected);
+        return total_covered == source_count;
+    }
+
+    /*
+     * Move selected facilities in front of the recency order, keeping the order of the rest
+     */
+    void updateRecency(std::vector<I>& selected) {
+        if (selected.size() == 0) {
+            return;
+        }
+        for (I k = 0; k < selected.size(); k++) {
+            selected_flag[selected[k]] = true;
+        }
+        std::vector<I> order(selected.begin(), selected.end());
+        for (I k = 0; k < recency.size(); k++) {
+            if (!selected_flag[recency[k]]) {
+                order.push_back(recency[k]);
+            }
+        }
+        for (I k = 0; k < selected.size(); k++) {
+            selected_flag[selected[k]] = false;
+        }
+        recency.swap(order);
+    }
+};
+
+#endif //FCLA_SETCOVER_H
@@ -0,0 +1,148 @@
+/*
+ * Static KD-tree over points (node coordinates) with removal, for nearest-point queries.
+ *
+ * Points are identified by their position in the list given at construction. The tree is implicit: a range of
+ * the point order is split at its middle point by the axis of the larger spread. Removed points stay in the tree,
+ * subtrees without remaining points are skipped by the search.
+ */
+
+#ifndef FCLA_SPATIALINDEX_H
+#define FCLA_SPATIALINDEX_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+class SpatialIndex {
+public:
+    std::vector<std::pair<double,double>> points;
+    std::vector<long> order; //points in tree order, the root of range [lo,hi) is at (lo+hi)/2
+    std::vector<long> position; //position of a point in order
+    std::vector<bool> split_by_y; //per tree position
+    std::vector<long> remaining; //per tree position: not removed points in its subtree
+    std::vector<bool> removed;
+    long remaining_count = 0;
+
+    /*
+     * Index of points coords[ids[i]], the point ids[i] is referred to as i
+     */
+    SpatialIndex(const std::vector<std::pair<double,double>>& coords, const std::vector<long>& ids) {
+        long n = ids.size();
+        points.resize(n);
+        for (long i = 0; i < n; i++) {
+            points[i] = coords[ids[i]];
+        }
+        order.resize(n);
+        for (long i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        split_by_y.assign(n, false);
+        remaining.assign(n, 0);
+        removed.assign(n, false);
+        remaining_count = n;
+        build(0, n);
+        position.resize(n);
+        for (long i = 0; i < n; i++) {
+            position[order[i]] = i;
+        }
+    }
+
+    inline long size() const {
+        return remaining_count;
+    }
+
+    void build(long lo, long hi) {
+        if (lo >= hi) {
+            return;
+        }
+        double min_x = points[order[lo]].first, max_x = min_x;
+        double min_y = points[order[lo]].second, max_y = min_y;
+        for (long i = lo + 1; i < hi; i++) {
+            const std::pair<double,double>& p = points[order[i]];
+            min_x = std::min(min_x, p.first);
+            max_x = std::max(max_x, p.first);
+            min_y = std::min(min_y, p.second);
+            max_y = std::max(max_y, p.second);
+        }
+        long mid = (lo + hi) / 2;
+        bool by_y = max_y - min_y > max_x - min_x;
+        const std::vector<std::pair<double,double>>& pts = points;
+        std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&pts, by_y](long a, long b) {
+            return by_y ? pts[a].second < pts[b].second : pts[a].first < pts[b].first;
+        });
+        split_by_y[mid] = by_y;
+        remaining[mid] = hi - lo;
+        build(lo, mid);
+        build(mid + 1, hi);
+    }
+
+    inline double distance(const std::pair<double,double>& query, long point) const {
+        return sqrt(pow(query.first - points[point].first, 2) + pow(query.second - points[point].second, 2));
+    }
+
+    /*
+     * Closest remaining point, the first one in the given list among equally distant, -1 if there are none
+     */
+    long nearest(const std::pair<double,double>& query) const {
+        long best = -1;
+        double best_dist = std::numeric_limits<double>::infinity();
+        search(0, order.size(), query, best, best_dist);
+        return best;
+    }
+
+    void search(long lo, long hi, const std::pair<double,double>& query, long& best, double& best_dist) const {
+        if (lo >= hi) {
+            return;
+        }
+        long mid = (lo + hi) / 2;
+        if (remaining[mid] == 0) {
+            return;
+        }
+        long point = order[mid];
+        if (!removed[point]) {
+            double dist = distance(query, point);
+            if (dist < best_dist || (dist == best_dist && point < best)) {
+                best = point;
+                best_dist = dist;
+            }
+        }
+        double diff = split_by_y[mid] ? query.second - points[point].second : query.first - points[point].first;
+        if (diff < 0) {
+            search(lo, mid, query, best, best_dist);
+            if (-diff <= best_dist) {
+                search(mid + 1, hi, query, best, best_dist);
+            }
+        } else {
+            search(mid + 1, hi, query, best, best_dist);
+            if (diff <= best_dist) {
+                search(lo, mid, query, best, best_dist);
+            }
+        }
+    }
+
+    void remove(long point) {
+        if (removed[point]) {
+            return;
+        }
+        removed[point] = true;
+        remaining_count--;
+        long target = position[point];
+        long lo = 0, hi = order.size();
+        while (lo < hi) {
+            long mid = (lo + hi) / 2;
+            remaining[mid]--;
+            if (target == mid) {
+                break;
+            }
+            if (target < mid) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+    }
+};
+
+#endif //FCLA_SPATIALINDEX_H
@@ -1,6 +1,9 @@
 /*
  * The purpose of this generator is to simultaneously throw edges from already partially explored graph
  * and use ExploringEdgeGenerator to retrieve distances to particular targets that are not yet explored
+ *
+ * Memorized edges of the explorer are a prefix of its output per customer (in non-decreasing weight order),
+ * so they are replayed in the order they were generated, and exploration resumes right after them.
  */
 
 #ifndef FCLA_TARGETEDGEGENERATOR_H
@@ -22,6 +25,7 @@ public:
     //this contains flags whether all targets in bipartite graph are already thrown by this generator
     //if yes but not all targets are thrown then continue exploring in edge_explorer until all targets are reached
     std::vector<std::vector<newEdge>> edgeQueue; //this serves to save already explored edges in sorted order
+    std::vector<long> queue_cursor; //next edge to replay per customer
     std::vector<long> targets_reached;
     std::vector<long> is_target;
 
@@ -48,9 +52,8 @@ public:
         }
         this->targets_reached[vid]++;
         //some remains from explored edges
-        if (edgeQueue[vid].size() > 0) {
-            new_edge = edgeQueue[vid].back();
-            edgeQueue[vid].pop_back();
+        if (queue_cursor[vid] < edgeQueue[vid].size()) {
+            new_edge = edgeQueue[vid][queue_cursor[vid]++];
             edgeMemory.push_back(new_edge);
             return new_edge;
         }
@@ -80,7 +83,7 @@ public:
          * in bipartite graph in matcher. so, in general non-network case, the right side is a set of all potential locations
          * and only id of a potential location can be returned by a generator
          */
-        is_target.resize(this->matcher->edge_generator->m,-1); //size of bipartite is size of sources plus targets
+        is_target.assign(this->matcher->edge_generator->m,-1); //size of bipartite is size of sources plus targets
         for (long i = 0; i < target_indexes.size(); i++) {
             is_target[target_indexes[i]] = i;
         }
@@ -92,18 +95,16 @@ public:
         std::vector<newEdge> empty_vec;
         edgeQueue.clear();
         edgeQueue.resize(this->n, empty_vec);
+        queue_cursor.assign(this->n, 0);
 
         //traverse all memorized edges and add those which are relevant to the current targets
-        for (long i = 0; i < this->matcher->edge_generator->edgeMemory.size(); i++) {
-            newEdge e = this->matcher->edge_generator->edgeMemory[i];
-            if (is_target[e.target_node - this->n] > -1) {
+        newEdges& memory = this->edge_explorer->edgeMemory;
+        for (long i = 0; i < memory.size(); i++) {
+            newEdge e = memory[i];
+            if (e.exists && is_target[e.target_node - this->n] > -1) {
                 e.target_node = this->n + is_target[e.target_node - this->n];
                 edgeQueue[e.source_node].push_back(e);
             }
-            //sort values
-            std::sort(edgeQueue[e.source_node].begin(), edgeQueue[e.source_node].end(), [](const newEdge a, const newEdge b) {
-                return a.weight > b.weight;
-            });
         }
     }
 };
@@ -7,26 +7,28 @@
 
 #include "ExploringEdgeGenerator.h"
 
-template<typename I, typename W>
-class TargetExploringEdgeGenerator : public ExploringEdgeGenerator<I,W> {
+template<typename I, typename W, class Heap = fHeap<W,I>>
+class TargetExploringEdgeGenerator : public ExploringEdgeGenerator<I,W,Heap> {
 public:
     std::vector<bool> is_target;
     std::vector<long> reverse_index;
     std::vector<newEdge> buffer;
 
     void reset() override {
+        this->edgeMemory.clear();
         this->init_dijkstra();
+        this->prefetch();
         for (long i = 0; i < this->n; i++) {
             updateBuffer(i);
         }
     }
 
     TargetExploringEdgeGenerator(Network& network,
-                                 std::vector<long>& target_indexes) : ExploringEdgeGenerator<I,W>(network) {
+                                 std::vector<long>& target_indexes) : ExploringEdgeGenerator<I,W,Heap>(network) {
         this->m = target_indexes.size();
         this->buffer.resize(this->n);
-        is_target.resize(igraph_vcount(&network.graph),false);
-        reverse_index.resize(igraph_vcount(&network.graph),-1);
+        is_target.resize(network.graph_size(),false);
+        reverse_index.resize(network.graph_size(),-1);
         for (long i = 0; i < target_indexes.size(); i++) {
             is_target[target_indexes[i]] = true;
             reverse_index[target_indexes[i]] = i;
@@ -39,37 +41,27 @@ public:
         return this->reverse_index[node_id];
     }
 
+    /*
+     * Explore until the next potential facility is settled
+     */
+    bool settleNextTarget(I stream_id, I& vid, W& shortest_dist) override {
+        while (this->settleNext(stream_id, vid, shortest_dist)) {
+            if (is_target[vid]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    long getTargetNode(I vid) override {
+        return getIndexOfFacilityInBGraph(vid);
+    }
+
     void updateBuffer(long vid) {
         newEdge e;
         e.exists = false;
-        if (vid < this->n) {
-            while (this->dheaps[vid].size() > 0) {
-                I next_vid;
-                W shortest_dist;
-                this->dheaps[vid].dequeue(next_vid, shortest_dist);
-                this->visited[vid][next_vid] = true;
-                this->updateNeighbors(vid, next_vid, shortest_dist);
-                if (is_target[next_vid]) {
-                    e.exists = true;
-                    e.capacity = 1;
-                    e.source_node = vid;
-                    //for target node we must return ID of a facility
-//                    assert(reverse_index[next_vid] >= 0);
-                    e.target_node = getIndexOfFacilityInBGraph(next_vid);
-                    e.weight = shortest_dist; //shortest distance between
-
-//                    for (long i = 0; i < this->edgeMemory.size(); i++) {
-//                        if ((this->edgeMemory[i].source_node == e.source_node) &&
-//                                (this->edgeMemory[i].source_node == e.target_node)) {
-//                            std::cout << "55--234234" << std::endl;
-//                            exit(1);
-//                        }
-//                    }
-
-                    this->edgeMemory.push_back(e);
-                    break;
-                }
-            }
+        if (vid < this->n && this->nextEdge(vid, e)) {
+            this->edgeMemory.push_back(e);
         }
         buffer[vid] = e;
     }
@@ -5,7 +5,9 @@
 #ifndef FCLA_VISITOR_H
 #define FCLA_VISITOR_H
 
-#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
 #include "osmpbfreader.h"
 
 using namespace CanalTP;
@@ -16,62 +18,63 @@ public:
     /*
      * Callbacks are called whenever a OSM member in pbf file is considered
      * Properties of the member are passed into a callback as arguments
+     *
+     * The file is read twice. WAYS pass keeps the node references of highway ways and ignores nodes,
+     * NODES pass keeps coordinates of only the referenced nodes, looked up in the sorted list of their ids.
+     * Nothing is stored per node of the file, so memory depends on the road network only.
      */
-    igraph_vector_t nodes;
-    std::map<uint64_t, long int > node_index;
-    igraph_vector_t edges;
-    igraph_vector_t edge_ids;
-    igraph_vector_t node_lat;
-    igraph_vector_t node_lon;
+    enum Pass {WAYS, NODES};
+    Pass pass = WAYS;
+    bool keep_tags = false; //node tags and edge types (highway values), needed only for the tagged output
+
+    //highway ways: refs of way w are in [way_offsets[w], way_offsets[w+1]) of way_refs
+    std::vector<uint64_t> way_ids;
+    std::vector<uint64_t> way_offsets = {0};
+    std::vector<uint64_t> way_refs;
+    std::vector<std::string> way_type;
+
+    //referenced nodes sorted by osm id, coordinates are filled in NODES pass
+    std::vector<uint64_t> nodes;
+    std::vector<double> node_lat;
+    std::vector<double> node_lon;
+    std::vector<bool> node_found;
     std::vector<Tags> node_tags;
-    std::vector<std::string> edge_type;
+    long cursor = 0; //nodes in pbf are usually sorted by id, lookup continues from the previous one
 
-    Visitor() {
-        igraph_vector_init(&nodes, 0);
-        igraph_vector_init(&edges, 0);
-        igraph_vector_init(&edge_ids, 0);
-        igraph_vector_init(&node_lat, 0);
-        igraph_vector_init(&node_lon, 0);
-    }
-    ~Visitor() {
-        igraph_vector_destroy(&nodes);
-        igraph_vector_destroy(&edges);
-        igraph_vector_destroy(&edge_ids);
-        igraph_vector_destroy(&node_lat);
-        igraph_vector_destroy(&node_lon);
-    }
+    std::vector<std::string> edge_type;
 
     void node_callback(uint64_t osmid, double lon, double lat, const Tags &tags){
-        node_index.insert(std::pair<uint64_t, long int >(osmid,igraph_vector_size(&nodes)));
-        igraph_vector_push_back(&nodes, osmid);
-        igraph_vector_push_back(&node_lat, lat);
-        igraph_vector_push_back(&node_lon, lon);
-        node_tags.push_back(tags);
+        if (pass != NODES) {
+            return;
+        }
+        std::vector<uint64_t>::iterator from = nodes.begin();
+        if (cursor < nodes.size() && nodes[cursor] <= osmid) {
+            from += cursor;
+        }
+        std::vector<uint64_t>::iterator it = std::lower_bound(from, nodes.end(), osmid);
+        cursor = it - nodes.begin();
+        if (it == nodes.end() || *it != osmid) {
+            return;
+        }
+        node_lat[cursor] = lat;
+        node_lon[cursor] = lon;
+        node_found[cursor] = true;
+        if (keep_tags) {
+            node_tags[cursor] = tags;
+        }
     }
     void way_callback(uint64_t osmid, const Tags &tags, const std::vector<uint64_t> &refs){
-        //add edge along the way and add ID of the way for each added edge
-        if (refs.size() < 2)
+        //only roads make edges, other ways (buildings, landuse, railways...) are skipped
+        if (pass != WAYS || refs.size() < 2)
             return;
-        uint64_t prev;
-        for (std::vector<uint64_t>::const_iterator it = refs.begin(); it != refs.end(); ++it) {
-            //add node reference two times per node: ...->1->2->3->... ---> ...->1 1->2 2->3 3->...
-            if (it != refs.begin()) {
-                igraph_vector_push_back(&edges,prev);
-                igraph_vector_push_back(&edge_ids,osmid);
-                igraph_vector_push_back(&edges,*it);
-            }
-            prev = *it;
-            if (tags.find("highway") != tags.end()) {
-                edge_type.push_back(tags.at("highway"));
-            } else {
-                if (((tags.find("area") != tags.end()) && (tags.at("area") == "yes"))
-                    || (tags.find("barrier") != tags.end())
-                    || (tags.find("railway") != tags.end())) {
-                    edge_type.push_back("unrelated");
-                } else {
-                    edge_type.push_back("undefined");
-                }
-            }
+        Tags::const_iterator highway = tags.find("highway");
+        if (highway == tags.end())
+            return;
+        way_ids.push_back(osmid);
+        way_refs.insert(way_refs.end(), refs.begin(), refs.end());
+        way_offsets.push_back(way_refs.size());
+        if (keep_tags) {
+            way_type.push_back(highway->second);
         }
     }
     void relation_callback(uint64_t osmid, const Tags &tags, const References &refs){
@@ -79,20 +82,95 @@ public:
         return;
     }
 
+    /*
+     * After WAYS pass: index of referenced node ids for NODES pass
+     */
+    void collect_nodes() {
+        nodes = way_refs;
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        nodes.shrink_to_fit();
+        node_lat.assign(nodes.size(), 0);
+        node_lon.assign(nodes.size(), 0);
+        node_found.assign(nodes.size(), false);
+        if (keep_tags) {
+            node_tags.assign(nodes.size(), Tags());
+        }
+        cursor = 0;
+        pass = NODES;
+    }
+
+    long find_node(uint64_t osmid) {
+        std::vector<uint64_t>::iterator it = std::lower_bound(nodes.begin(), nodes.end(), osmid);
+        return it != nodes.end() && *it == osmid ? it - nodes.begin() : -1;
+    }
+
+    /*
+     * After NODES pass. Referenced nodes missing in the file (cut by the extract) are dropped with their edges.
+     */
     void set_graph(igraph_t* gp) {
-        igraph_empty(gp, igraph_vector_size(&nodes), IGRAPH_UNDIRECTED);
+        long found = 0;
+        for (long i = 0; i < nodes.size(); i++) {
+            if (node_found[i]) {
+                nodes[found] = nodes[i];
+                node_lat[found] = node_lat[i];
+                node_lon[found] = node_lon[i];
+                if (keep_tags) {
+                    std::swap(node_tags[found], node_tags[i]);
+                }
+                found++;
+            }
+        }
+        nodes.resize(found);
 
-        //map edge osmids to internal node ids
-        for (uint64_t i = 0; i < igraph_vector_size(&edges); i++) {
-            igraph_real_t nodeid = node_index[igraph_vector_e(&edges, i)];
-            igraph_vector_set(&edges, i, nodeid);
+        //add edge along the way and add ID of the way for each added edge: ...->1 1->2 2->3 3->...
+        igraph_vector_t edges;
+        igraph_vector_t edge_ids;
+        igraph_vector_init(&edges, 0);
+        igraph_vector_init(&edge_ids, 0);
+        edge_type.clear();
+        for (long w = 0; w < way_ids.size(); w++) {
+            for (uint64_t r = way_offsets[w] + 1; r < way_offsets[w + 1]; r++) {
+                long from = find_node(way_refs[r - 1]);
+                long to = find_node(way_refs[r]);
+                if (from == -1 || to == -1) {
+                    continue;
+                }
+                igraph_vector_push_back(&edges, from);
+                igraph_vector_push_back(&edges, to);
+                igraph_vector_push_back(&edge_ids, way_ids[w]);
+                if (keep_tags) {
+                    edge_type.push_back(way_type[w]);
+                }
+            }
         }
 
+        igraph_vector_t node_ids;
+        igraph_vector_t lat;
+        igraph_vector_t lon;
+        igraph_vector_init(&node_ids, found);
+        igraph_vector_init(&lat, found);
+        igraph_vector_init(&lon, found);
+        for (long i = 0; i < found; i++) {
+            igraph_vector_set(&node_ids, i, nodes[i]);
+            igraph_vector_set(&lat, i, node_lat[i]);
+            igraph_vector_set(&lon, i, node_lon[i]);
+        }
+        if (keep_tags) {
+            node_tags.resize(found);
+        }
+
+        igraph_empty(gp, found, IGRAPH_UNDIRECTED);
         igraph_add_edges(gp, &edges, 0);
-        igraph_cattribute_VAN_setv(gp, "lat", &node_lat);
-        igraph_cattribute_VAN_setv(gp, "lon", &node_lon);
+        igraph_cattribute_VAN_setv(gp, "lat", &lat);
+        igraph_cattribute_VAN_setv(gp, "lon", &lon);
         igraph_cattribute_EAN_setv(gp, "osmid", &edge_ids);
-        igraph_cattribute_VAN_setv(gp, "osmid", &nodes);
+        igraph_cattribute_VAN_setv(gp, "osmid", &node_ids);
+        igraph_vector_destroy(&edges);
+        igraph_vector_destroy(&edge_ids);
+        igraph_vector_destroy(&node_ids);
+        igraph_vector_destroy(&lat);
+        igraph_vector_destroy(&lon);
     }
 };
 
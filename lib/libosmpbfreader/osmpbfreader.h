@@ -32,6 +32,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // this describes the low-level blob storage
 #include <osmpbf/fileformat.pb.h>
@@ -64,9 +70,9 @@ struct Reference {
 
 typedef std::vector<Reference> References;
 
-// Main function
+// Main function, blobs are inflated and decoded by <threads> workers if more than one
 template<typename Visitor>
-void read_osm_pbf(const std::string & filename, Visitor & visitor);
+void read_osm_pbf(const std::string & filename, Visitor & visitor, unsigned threads = 1);
 
 struct warn {
     warn() {std::cout << "\033[33m[WARN] ";}
@@ -105,6 +111,10 @@ template<typename Visitor>
 struct Parser {
 
     void parse(){
+        if(this->threads > 1) {
+            this->parse_parallel();
+            return;
+        }
         while(!this->file.eof() && !finished) {
             OSMPBF::BlobHeader header = this->read_header();
             if(!this->finished){
@@ -121,8 +131,8 @@ struct Parser {
         }
     }
 
-    Parser(const std::string & filename, Visitor & visitor)
-        : visitor(visitor), file(filename.c_str(), std::ios::binary ), finished(false)
+    Parser(const std::string & filename, Visitor & visitor, unsigned threads = 1)
+        : visitor(visitor), file(filename.c_str(), std::ios::binary ), finished(false), threads(threads)
     {
         if(!file.is_open())
             fatal() << "Unable to open the file " << filename;
@@ -134,7 +144,7 @@ struct Parser {
     ~Parser(){
         delete[] buffer;
         delete[] unpack_buffer;
-        google::protobuf::ShutdownProtobufLibrary();
+        // protobuf is not shut down here: a file may be read several times (RoadNetwork reads it in two passes)
     }
 
 private:
@@ -143,6 +153,97 @@ private:
     char* buffer;
     char* unpack_buffer;
     bool finished;
+    unsigned threads;
+
+    // a blob on its way through parse_parallel
+    struct Slot {
+        std::string data; // serialized blob as read from the file
+        bool is_data;
+        bool decoded;
+        OSMPBF::PrimitiveBlock primblock;
+    };
+
+    /*
+     * Pipelined parse: this thread reads raw blobs into a window of slots, worker threads inflate and decode them,
+     * and this thread passes decoded blocks to the visitor in file order. The visitor is called from one thread only.
+     */
+    void parse_parallel(){
+        const size_t window = 4 * this->threads;
+        std::vector<Slot> slots(window);
+        size_t next_read = 0;
+        size_t next_decode = 0;
+        size_t next_deliver = 0;
+        bool stopped = false;
+        std::mutex mutex;
+        std::condition_variable work_ready;
+        std::condition_variable work_done;
+
+        auto worker = [&slots, &window, &next_read, &next_decode, &stopped, &mutex, &work_ready, &work_done]() {
+            char* unpacked = new char[max_uncompressed_blob_size];
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true) {
+                while(!stopped && next_decode == next_read)
+                    work_ready.wait(lock);
+                if(next_decode == next_read)
+                    break;
+                Slot & slot = slots[next_decode % window];
+                next_decode++;
+                lock.unlock();
+                if(slot.is_data) {
+                    int32_t sz = unpack_blob(slot.data.data(), slot.data.size(), unpacked);
+                    if(!slot.primblock.ParseFromArray(unpacked, sz))
+                        fatal() << "unable to parse primitive block";
+                }
+                lock.lock();
+                slot.decoded = true;
+                work_done.notify_all();
+            }
+            delete[] unpacked;
+        };
+        std::vector<std::thread> workers;
+        for(unsigned t = 0; t < this->threads; t++) {
+            workers.push_back(std::thread(worker));
+        }
+
+        while(true) {
+            // next_read and next_deliver are changed by this thread only
+            while(!this->finished && next_read - next_deliver < window) {
+                OSMPBF::BlobHeader header = this->read_header();
+                if(this->finished)
+                    break;
+                Slot & slot = slots[next_read % window];
+                slot.is_data = header.type() == "OSMData";
+                if(!slot.is_data && header.type() != "OSMHeader")
+                    warn() << "  unknown blob type: " << header.type();
+                this->read_blob_data(header, slot.data);
+                slot.decoded = false;
+                std::lock_guard<std::mutex> lock(mutex);
+                next_read++;
+                work_ready.notify_one();
+            }
+            if(next_deliver == next_read)
+                break;
+            Slot & slot = slots[next_deliver % window];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while(!slot.decoded)
+                    work_done.wait(lock);
+            }
+            if(slot.is_data)
+                this->deliver(slot.primblock);
+            slot.primblock.Clear();
+            next_deliver++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        work_ready.notify_all();
+        for(size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
 
     OSMPBF::BlobHeader read_header(){
         int32_t sz;
@@ -171,7 +272,6 @@ private:
     }
 
     int32_t read_blob(const OSMPBF::BlobHeader & header){
-        OSMPBF::Blob blob;
         // size of the following blob
         int32_t sz = header.datasize();
 
@@ -180,7 +280,25 @@ private:
 
         if(!this->file.read(buffer, sz))
             fatal() << "unable to read blob from file";
-        if(!blob.ParseFromArray(this->buffer, sz))
+        return unpack_blob(this->buffer, sz, this->unpack_buffer);
+    }
+
+    // serialized blob without unpacking, for parse_parallel
+    void read_blob_data(const OSMPBF::BlobHeader & header, std::string & data){
+        int32_t sz = header.datasize();
+
+        if(sz > max_uncompressed_blob_size)
+            fatal() << "blob-size is bigger then allowed";
+
+        data.resize(sz);
+        if(!this->file.read(&data[0], sz))
+            fatal() << "unable to read blob from file";
+    }
+
+    // parse a serialized blob and write its uncompressed content to unpacked, returns the size of the content
+    static int32_t unpack_blob(const char* data, int32_t sz, char* unpacked){
+        OSMPBF::Blob blob;
+        if(!blob.ParseFromArray(data, sz))
             fatal() << "unable to parse blob";
 
         // if the blob has uncompressed data
@@ -192,7 +310,7 @@ private:
             if(sz != blob.raw_size())
                 warn() << "  reports wrong raw_size: " << blob.raw_size() << " bytes";
 
-            memcpy(unpack_buffer, buffer, sz);
+            memcpy(unpacked, blob.raw().data(), sz);
             return sz;
         }
 
@@ -203,7 +321,7 @@ private:
             z_stream z;
             z.next_in   = (unsigned char*) blob.zlib_data().c_str();
             z.avail_in  = sz;
-            z.next_out  = (unsigned char*) unpack_buffer;
+            z.next_out  = (unsigned char*) unpacked;
             z.avail_out = blob.raw_size();
             z.zalloc    = Z_NULL;
             z.zfree     = Z_NULL;
@@ -231,13 +349,17 @@ private:
         OSMPBF::PrimitiveBlock primblock;
         if(!primblock.ParseFromArray(this->unpack_buffer, sz))
             fatal() << "unable to parse primitive block";
+        this->deliver(primblock);
+    }
 
+    // pass the members of a decoded block to the visitor
+    void deliver(const OSMPBF::PrimitiveBlock & primblock) {
         for(int i = 0, l = primblock.primitivegroup_size(); i < l; i++) {
-            OSMPBF::PrimitiveGroup pg = primblock.primitivegroup(i);
+            const OSMPBF::PrimitiveGroup & pg = primblock.primitivegroup(i);
 
             // Simple Nodes
             for(int i = 0; i < pg.nodes_size(); ++i) {
-                OSMPBF::Node n = pg.nodes(i);
+                const OSMPBF::Node & n = pg.nodes(i);
 
                 double lon = 0.000000001 * (primblock.lon_offset() + (primblock.granularity() * n.lon())) ;
                 double lat = 0.000000001 * (primblock.lat_offset() + (primblock.granularity() * n.lat())) ;
@@ -246,7 +368,7 @@ private:
 
             // Dense Nodes
             if(pg.has_dense()) {
-                OSMPBF::DenseNodes dn = pg.dense();
+                const OSMPBF::DenseNodes & dn = pg.dense();
                 uint64_t id = 0;
                 double lon = 0;
                 double lat = 0;
@@ -273,7 +395,7 @@ private:
             }
 
             for(int i = 0; i < pg.ways_size(); ++i) {
-                OSMPBF::Way w = pg.ways(i);
+                const OSMPBF::Way & w = pg.ways(i);
 
                 uint64_t ref = 0;
                 std::vector<uint64_t> refs;
@@ -287,7 +409,7 @@ private:
 
 
             for(int i=0; i < pg.relations_size(); ++i){
-                OSMPBF::Relation rel = pg.relations(i);
+                const OSMPBF::Relation & rel = pg.relations(i);
                 uint64_t id = 0;
                 References refs;
 
@@ -303,8 +425,8 @@ private:
 };
 
 template<typename Visitor>
-void read_osm_pbf(const std::string & filename, Visitor & visitor){
-    Parser<Visitor> p(filename, visitor);
+void read_osm_pbf(const std::string & filename, Visitor & visitor, unsigned threads){
+    Parser<Visitor> p(filename, visitor, threads);
     p.parse();
 }
 
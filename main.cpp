@@ -4,13 +4,17 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <boost/program_options.hpp>
 
 #include "helpers.h"
 #include "Network.h"
 #include "FacilityChooser.h"
+#include "ComponentFacilityChooser.h"
 #include "igraph/igraph.h"
 #include "Logger.h"
+#include "LagrangianBound.h"
+#include "GraphSimplifier.h"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -24,8 +28,14 @@ int main(int argc, const char** argv) {
     bool partially_uniform;
     int greedy_matching;
     int objective_matching;
+    long prefetch_size;
+    unsigned threads;
     string out_filename;
+    bool use_ch;
+    bool per_component;
     string facilityfilename;
+    long bound_candidates;
+    bool simplify;
 
     po::options_description desc("Allowed options");
     desc.add_options()
@@ -39,6 +49,12 @@ int main(int argc, const char** argv) {
             ("partuni,p", po::value<bool>(&partially_uniform)->default_value(false), "Calculate objective by non-uni cap and assignment by uniform cap")
             ("greedy,g", po::value<int>(&greedy_matching)->default_value(0), "Perform greedy matching, 0 - disabled, 1 - random, 2 - hilbert, 3 - distance")
             ("matching,m", po::value<int>(&objective_matching)->default_value(1), "0 - SIA objective, 1 - greedy matching objective if -g specified (default)")
+            ("prefetch,k", po::value<long>(&prefetch_size)->default_value(0), "Nearest facilities explored per customer before matching, 0 - lazy exploration only")
+            ("threads,t", po::value<unsigned>(&threads)->default_value(1), "Number of threads for prefetching and for solving components")
+            ("ch", po::value<bool>(&use_ch)->default_value(false), "Compute distances with a contraction hierarchy of the network")
+            ("components", po::value<bool>(&per_component)->default_value(false), "Solve weak components of the network independently and concurrently")
+            ("simplify", po::value<bool>(&simplify)->default_value(false), "Contract chains of degree-2 nodes that are neither customers nor potential facilities")
+            ("lowerbound,b", po::value<long>(&bound_candidates)->default_value(0), "Lagrangian lower bound over this many nearest facilities per customer, 0 - disabled")
             ("output,o", po::value<string>(&out_filename)->required(), "Output file");
 
     po::variables_map vm;
@@ -55,12 +71,58 @@ int main(int argc, const char** argv) {
         logger.start2("reading file");
         Network net(filename, facilityfilename);
         logger.finish2("reading file");
+        Network* network = &net;
+        std::unique_ptr<GraphSimplifier> simplifier; //outlives the choosers that work on its network
+        if (simplify) {
+            logger.start2("simplification");
+            simplifier.reset(new GraphSimplifier(net));
+            network = simplifier->simplified;
+            logger.finish2("simplification");
+            logger.add("simplified nodes", network->graph_size());
+            logger.add("simplified edges", network->weights.size());
+        }
+
+        if (per_component) {
+            ComponentFacilityChooser fcla(*network, facilities_to_locate, facility_capacity, &logger, lambda, alpha, partially_uniform);
+            fcla.greedyMatching = greedy_matching != 0;
+            fcla.objective_matching = objective_matching;
+            fcla.greedyMatchingOrder = greedy_matching;
+            fcla.use_ch = use_ch;
+            fcla.threads = threads;
+            //threads are spent on components, each component prefetches on one thread
+            fcla.prefetch_size = prefetch_size;
+            fcla.run();
+            if (bound_candidates > 0) {
+                log_lagrangian_bound(*network, facilities_to_locate, facility_capacity, bound_candidates, use_ch, &logger);
+            }
+            if (simplifier != nullptr) {
+                simplifier->restore_ids(&logger);
+            }
+            cout << logger.float_dict["objective"][0] << " " << logger.float_dict["runtime"][0] << endl;
+            logger.finish("total time");
+            logger.save(out_filename);
+            return 0;
+        }
 
-        FacilityChooser fcla(net, facilities_to_locate, facility_capacity, &logger, lambda, alpha, partially_uniform);
+        FacilityChooser fcla(*network, facilities_to_locate, facility_capacity, &logger, lambda, alpha, partially_uniform);
         fcla.greedyMatching = greedy_matching != 0;
         fcla.objective_matching = objective_matching;
         fcla.greedyMatchingOrder = greedy_matching;
+        if (use_ch) {
+            logger.start2("contraction hierarchy");
+            fcla.setContractionHierarchy(true);
+            logger.finish2("contraction hierarchy");
+        }
+        if (prefetch_size > 0) {
+            fcla.setPrefetch(prefetch_size, threads);
+        }
         fcla.run();
+        if (bound_candidates > 0) {
+            log_lagrangian_bound(*network, facilities_to_locate, facility_capacity, bound_candidates, use_ch, &logger);
+        }
+        if (simplifier != nullptr) {
+            simplifier->restore_ids(&logger);
+        }
         switch(fcla.state) {
             case FacilityChooser::LOCATED:
                 cout << logger.float_dict["objective"][0] << " " << logger.float_dict["runtime"][0] << endl;
@@ -0,0 +1,49 @@
+/*
+ * Conversion between text (.ntw) and binary (.ntwb) network formats
+ */
+
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+
+#include "helpers.h"
+#include "Network.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, const char** argv) {
+    string filename;
+    string facilityfilename;
+    string out_filename;
+    bool with_index;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("help,h", "produce help message")
+            ("input,i", po::value<string>(&filename)->required(), "Input file, a network (.ntw or .ntwb)")
+            ("facilityfile,f", po::value<string>(&facilityfilename)->default_value(""), "List of potential facilities, stored in the binary output")
+            ("csr,r", po::value<bool>(&with_index)->default_value(true), "Store CSR adjacency and components in the binary output")
+            ("output,o", po::value<string>(&out_filename)->required(), "Output file, format is chosen by extension");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+        cout << desc << "\n";
+        return 1;
+    }
+    po::notify(vm);
+
+    try {
+        Network net(filename, facilityfilename);
+        if (has_extension(out_filename, NTWB_EXTENSION)) {
+            net.save_binary_file(out_filename, with_index);
+        } else {
+            net.save("", out_filename);
+        }
+    } catch (const std::exception& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <thread>
 #include <boost/program_options.hpp>
 
 #include "helpers.h"
@@ -24,6 +25,8 @@ int main(int argc, const char** argv) {
     string filename;
     long customers_to_locate;
     bool tagged;
+    bool binary;
+    unsigned threads;
     string out_filename;
 
     po::options_description desc("Allowed options");
@@ -32,6 +35,8 @@ int main(int argc, const char** argv) {
             ("input,i", po::value<string>(&filename)->required(), "Input file, OSM file")
             ("customers,c", po::value<long>(&customers_to_locate)->required(), "Customers to locate")
             ("tagged,g", po::value<bool>(&tagged)->default_value(false), "Output graph contains tags for edges and coords for nodes")
+            ("binary,b", po::value<bool>(&binary)->default_value(false), "Save in binary format (.ntwb), ignored for tagged output")
+            ("threads,t", po::value<unsigned>(&threads)->default_value(std::thread::hardware_concurrency()), "Number of threads decoding the OSM file")
             ("output,o", po::value<string>(&out_filename)->required(), "Output directory (name automatic)");
 
     po::variables_map vm;
@@ -43,7 +48,8 @@ int main(int argc, const char** argv) {
     po::notify(vm);
 
     RoadNetwork network;
-    network.load_pbf(filename);
+    network.keep_tags = tagged;
+    network.load_pbf(filename, threads);
     network.transform_coordinates();
     network.make_weights();
 
@@ -55,7 +61,7 @@ int main(int argc, const char** argv) {
     if (tagged) {
         network.save_with_tag(out_filename, customers_to_locate);
     } else {
-        network.save_network(out_filename, customers_to_locate);
+        network.save_network(out_filename, customers_to_locate, binary);
     }
 
     return 0;
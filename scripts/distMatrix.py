@@ -0,0 +1,47 @@
+'''
+ load a distance matrix written by bin/distmatrix (.dm)
+
+ header: 4 bytes magic "DMTX", uint32 version, int64 rows, columns, nearest
+ then int64 arrays: row node ids, column node ids, distances (rows x width, -1 if unreachable)
+ and, if nearest > 0, column index of every distance (-1 if a row has fewer reachable columns)
+'''
+import numpy as np
+
+MAGIC = b"DMTX"
+VERSION = 1
+
+def load(filename):
+    '''
+     returns (row_nodes, column_nodes, distances, columns)
+     distances is rows x columns (dense) or rows x nearest, then columns holds column indexes, otherwise None
+    '''
+    with open(filename, "rb") as f:
+        magic = f.read(4)
+        version = int(np.frombuffer(f.read(4), dtype=np.uint32)[0])
+        if magic != MAGIC or version != VERSION:
+            raise Exception("Unsupported distance matrix format %s" % filename)
+        rows, columns, nearest = np.frombuffer(f.read(24), dtype=np.int64)
+        width = nearest if nearest > 0 else columns
+        row_nodes = np.fromfile(f, dtype=np.int64, count=rows)
+        column_nodes = np.fromfile(f, dtype=np.int64, count=columns)
+        distances = np.fromfile(f, dtype=np.int64, count=rows*width).reshape((rows, width))
+        nearest_columns = None
+        if nearest > 0:
+            nearest_columns = np.fromfile(f, dtype=np.int64, count=rows*width).reshape((rows, width))
+    return row_nodes, column_nodes, distances, nearest_columns
+
+def load_pairs(filename):
+    '''
+     returns (row_nodes, column_nodes, pairs), pairs is a dictionary (row, column) -> distance as written by
+     calculateDistMatr*.py, unreachable pairs are skipped. row and column are indexes into row_nodes and
+     column_nodes, callers with their own list of facilities have to map column_nodes onto it
+    '''
+    row_nodes, column_nodes, distances, nearest_columns = load(filename)
+    if nearest_columns is None:
+        ii, kk = np.nonzero(distances >= 0)
+        jj = kk
+    else:
+        ii, kk = np.nonzero((distances >= 0) & (nearest_columns >= 0))
+        jj = nearest_columns[ii, kk]
+    pairs = dict(zip(zip(ii.tolist(), jj.tolist()), distances[ii, kk].tolist()))
+    return row_nodes.tolist(), column_nodes.tolist(), pairs
@@ -1,5 +1,6 @@
 from gurobipy import *
 from Network import *
+import distMatrix
 import networkx as nx
 import sys
 import re
@@ -74,15 +75,25 @@ def run(network_file,facility_capacity,number_of_facilities,facilityfile="",dist
     calcdist = False
     if (distmatx != "") and (os.path.isfile(distmatx)):
         logging.info("Distance matrix found")
-        pkl_f = open(distmatx, "rb")
-        d = pkl.load(pkl_f)
-        pkl_f.close()
+        if distmatx.endswith(".dm"):
+            # written by bin/distmatrix, with -k only the nearest facilities of each client are present
+            row_nodes, column_nodes, pairs = distMatrix.load_pairs(distmatx)
+            if row_nodes != list(clients):
+                raise Exception("Rows of %s are not the clients of the network, use -m sta or -m stt" % distmatx)
+            # columns are nodes of the matrix (all nodes or its facility file), keep those of facility_index
+            position = {node: j for j, node in enumerate(facility_index)}
+            for (i, k), dist in pairs.items():
+                if column_nodes[k] in position:
+                    d[(i, position[column_nodes[k]])] = dist
+        else:
+            pkl_f = open(distmatx, "rb")
+            d = pkl.load(pkl_f)
+            pkl_f.close()
     else:
         # p = nx.shortest_path_length(network.G,weight="weight")
         for i in range(numClients):
             dijkstra_dist = nx.algorithms.shortest_paths.weighted.single_source_dijkstra_path_length(network.G, network.sources[i])
             for j in range(numFacilities):
-                y[(i, j)] = m.addVar(vtype=GRB.BINARY, name="t%d,%d" % (i,j))
                 if (i,j) not in d:
                     try:
                         # d[(i, j)] = p[network.sources[i]][facility_index[j]]
@@ -93,7 +104,12 @@ def run(network_file,facility_capacity,number_of_facilities,facilityfile="",dist
                     except nx.exception.NetworkXNoPath:
                         d[(i,j)] = GRB.INFINITY#float("inf")
 
-        if distmatx != "":
+        if distmatx.endswith(".dm"):
+            # .dm files are written only by bin/distmatrix, a pickle there would not load next time
+            logging.warning("%s does not exist, create it with bin/distmatrix -i %s%s -m stt -o %s" %
+                            (distmatx, network_file, " -f " + facilityfile if facilityfile != "" else "",
+                             distmatx[:-len(".dm")]))
+        elif distmatx != "":
             logging.info("Writing distance matrix to %s" % distmatx)
             pkl_f = open(distmatx, "wb")
             pkl.dump(d, pkl_f)
@@ -102,28 +118,37 @@ def run(network_file,facility_capacity,number_of_facilities,facilityfile="",dist
     # print("Dictionary size " + str(len(d)))
 
     end_time = time.time()
+
+    # a client can be assigned only to facilities of its distance matrix entries
+    facilities_of_client = {}
+    for (i, j) in d:
+        if i >= numClients or j >= numFacilities:
+            continue
+        y[(i, j)] = m.addVar(vtype=GRB.BINARY, name="t%d,%d" % (i,j))
+        facilities_of_client.setdefault(i, []).append(j)
+    clients_of_facility = {}
+    for (i, j) in y:
+        clients_of_facility.setdefault(j, []).append(i)
     m.update()
 
     # Add constraints
 
     # only located facilities can be assigned
-    for i in range(numClients):
-        for j in range(numFacilities):
-            m.addConstr(y[(i, j)] <= x[j])
+    for (i, j) in y:
+        m.addConstr(y[(i, j)] <= x[j])
 
     # each customer should be assigned once only
     for i in range(numClients):
-        m.addConstr(quicksum(y[(i, j)] for j in range(numFacilities)) == 1)
+        m.addConstr(quicksum(y[(i, j)] for j in facilities_of_client.get(i, [])) == 1)
 
     # each facility should be assigned not more than capacity times
     for j in range(numFacilities):
-        m.addConstr(quicksum(y[(i, j)] for i in range(numClients)) <= capacities[facility_index[j]])
+        m.addConstr(quicksum(y[(i, j)] for i in clients_of_facility.get(j, [])) <= capacities[facility_index[j]])
 
     # state the exact amount of facilities to be placed
     m.addConstr(quicksum(x[j] for j in range(numFacilities)) == number_of_facilities)
 
-    m.setObjective(quicksum(quicksum(d[(i, j)]*y[(i, j)]
-                   for i in range(numClients)) for j in range(numFacilities)))
+    m.setObjective(quicksum(d[(i, j)]*y[(i, j)] for (i, j) in y))
     m.optimize()
 
     if m.status == GRB.Status.OPTIMAL:
@@ -6,13 +6,23 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 #include <algorithm>
+#include <set>
+#include <lemon/list_graph.h>
+#include <lemon/cost_scaling.h>
 #include "EdgeGenerator.h"
 #include "helpers.h"
 #include "ExploringEdgeGenerator.h"
+#include "CHEdgeGenerator.h"
 #include "Network.h"
 #include "FacilityChooser.h"
+#include "ComponentFacilityChooser.h"
 #include "Logger.h"
 #include "exceptions.h"
+#include "SpatialIndex.h"
+#include "DistanceMatrix.h"
+#include "BranchAndBound.h"
+#include "LagrangianBound.h"
+#include "GraphSimplifier.h"
 
 BOOST_AUTO_TEST_CASE (testExplorator) {
     //generate random graph, calculate all-to-all distances and compare them with ExploringGenerator results.
@@ -56,6 +66,658 @@ BOOST_AUTO_TEST_CASE (testExplorator) {
     igraph_destroy(&graph);
 }
 
+BOOST_AUTO_TEST_CASE (testPrefetchedExplorator) {
+    //prefetched edges must be the same as lazily explored ones, also after the buffers are drained
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 100;
+    generate_random_geometric_graph(vsize,0.1,&graph,weights,&x,&y);
+    std::vector<long> source_index(vsize);
+    for (long i = 0; i < vsize; i++) {
+        source_index[i] = vsize - i - 1;
+    }
+    ExploringEdgeGenerator<long,long> lazyGenerator(&graph, weights, source_index);
+    ExploringEdgeGenerator<long,long> prefetchGenerator(&graph, weights, source_index);
+    prefetchGenerator.setPrefetch(5, 4);
+    prefetchGenerator.reset();
+    for (long i = 0; i < vsize; i++) {
+        BOOST_REQUIRE(prefetchGenerator.prefetched[i].size() <= 5);
+        for (long j = 0; j < 10; j++) {
+            BOOST_REQUIRE_EQUAL(lazyGenerator.isComplete(i), prefetchGenerator.isComplete(i));
+            newEdge lazy = lazyGenerator.getEdge(i);
+            newEdge prefetched = prefetchGenerator.getEdge(i);
+            BOOST_REQUIRE_EQUAL(lazy.exists, prefetched.exists);
+            BOOST_REQUIRE_EQUAL(lazy.weight, prefetched.weight);
+        }
+    }
+    BOOST_CHECK_EQUAL(lazyGenerator.edgeMemory.size(), prefetchGenerator.edgeMemory.size());
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testContractionHierarchyGenerator) {
+    //facilities must come in the same distance order as from exploration
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 200;
+    generate_random_geometric_graph(vsize,0.15,&graph,weights,&x,&y);
+    std::vector<long> sources;
+    std::vector<long> targets;
+    for (long i = 0; i < vsize; i += 7) sources.push_back(i);
+    for (long i = 3; i < vsize; i += 5) targets.push_back(i);
+    Network net(&graph, weights, sources);
+
+    TargetExploringEdgeGenerator<long,long> exploring(net, targets);
+    CHEdgeGenerator<long,long> hierarchy(net, targets);
+    for (long i = 0; i < sources.size(); i++) {
+        while (!exploring.isComplete(i)) {
+            BOOST_REQUIRE(!hierarchy.isComplete(i));
+            BOOST_REQUIRE_EQUAL(exploring.getEdge(i).weight, hierarchy.getEdge(i).weight);
+        }
+        BOOST_REQUIRE(hierarchy.isComplete(i));
+    }
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testDistanceMatrix) {
+    //customers x candidates block must agree with all-pairs distances, computed on several threads
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 150;
+    generate_random_geometric_graph(vsize,0.15,&graph,weights,&x,&y);
+    std::vector<long> sources;
+    std::vector<long> candidates;
+    for (long i = 0; i < vsize; i += 4) sources.push_back(i);
+    sources.push_back(0); //two customers at one node
+    for (long i = 1; i < vsize; i += 3) candidates.push_back(i);
+    Network net(&graph, weights, sources);
+    DistanceMatrix<long> distances(net.csr, sources, candidates, 3);
+
+    igraph_vector_t real_weights;
+    igraph_vector_init(&real_weights, igraph_ecount(&graph));
+    for (long i = 0 ; i < weights.size(); i++)
+        VECTOR(real_weights)[i] = weights[i];
+    igraph_vs_t all_nodes;
+    igraph_vs_all(&all_nodes);
+    igraph_matrix_t res_matx;
+    igraph_matrix_init(&res_matx, 0, 0);
+    igraph_shortest_paths_bellman_ford(&graph, &res_matx, all_nodes, all_nodes, &real_weights, IGRAPH_ALL);
+    for (long i = 0; i < sources.size(); i++) {
+        for (long j = 0; j < candidates.size(); j++) {
+            double expected = MATRIX(res_matx, sources[i], candidates[j]);
+            if (expected == IGRAPH_INFINITY) {
+                BOOST_REQUIRE_EQUAL(distances.at(i, j), DistanceMatrix<long>::unreachable());
+            } else {
+                BOOST_REQUIRE_EQUAL(distances.at(i, j), (long) expected);
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(distances.to_node(0, candidates[2]), distances.at(sources.size() - 1, 2));
+
+    //k closest columns are a prefix of the sorted dense row
+    long k = 5;
+    DistanceMatrix<long> nearest(net.csr, sources, candidates, 2, k);
+    for (long i = 0; i < sources.size(); i++) {
+        std::vector<long> row(distances.distances.begin() + i * candidates.size(),
+                              distances.distances.begin() + (i + 1) * candidates.size());
+        std::sort(row.begin(), row.end());
+        for (long r = 0; r < k; r++) {
+            long column = nearest.nearest_columns[i * k + r];
+            if (row[r] == DistanceMatrix<long>::unreachable()) {
+                BOOST_REQUIRE_EQUAL(column, -1);
+            } else {
+                BOOST_REQUIRE_EQUAL(nearest.distances[i * k + r], row[r]);
+                BOOST_REQUIRE_EQUAL(distances.at(i, column), row[r]);
+            }
+        }
+    }
+
+    igraph_matrix_destroy(&res_matx);
+    igraph_vector_destroy(&real_weights);
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+}
+
+//objective of a facility set on its own flow network, as in brutesolver, infeasible() if customers can not be served
+long assignment_cost(DistanceMatrix<long>& distances, std::vector<long>& set, long capacity) {
+    lemon::ListDigraph g;
+    lemon::ListDigraph::ArcMap<long> capacities(g);
+    lemon::ListDigraph::ArcMap<long> weights(g);
+    std::vector<lemon::ListDigraph::Node> nodes;
+    for (long i = 0; i < distances.rows + set.size(); i++) {
+        nodes.push_back(g.addNode());
+    }
+    lemon::ListDigraph::Node source = g.addNode();
+    lemon::ListDigraph::Node target = g.addNode();
+    for (long i = 0; i < distances.rows; i++) {
+        lemon::ListDigraph::Arc e = g.addArc(source, nodes[i]);
+        capacities[e] = 1;
+        weights[e] = 0;
+        for (long s = 0; s < set.size(); s++) {
+            long dist = distances.at(i, set[s]);
+            if (dist == DistanceMatrix<long>::unreachable()) continue;
+            e = g.addArc(nodes[i], nodes[distances.rows + s]);
+            capacities[e] = 1;
+            weights[e] = dist;
+        }
+    }
+    for (long s = 0; s < set.size(); s++) {
+        lemon::ListDigraph::Arc e = g.addArc(nodes[distances.rows + s], target);
+        capacities[e] = capacity;
+        weights[e] = 0;
+    }
+    lemon::CostScaling<lemon::ListDigraph, long, long> cost_scaling_alg(g);
+    cost_scaling_alg.upperMap(capacities);
+    cost_scaling_alg.costMap(weights);
+    cost_scaling_alg.stSupply(source, target, distances.rows);
+    if (cost_scaling_alg.run() != lemon::CostScaling<lemon::ListDigraph, long, long>::OPTIMAL) {
+        return BranchAndBound::infeasible();
+    }
+    return cost_scaling_alg.totalCost();
+}
+
+BOOST_AUTO_TEST_CASE (testBranchAndBound) {
+    //pruned search must find the optimum of exhaustive enumeration
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 30;
+    generate_random_geometric_graph(vsize,0.3,&graph,weights,&x,&y);
+    std::vector<long> sources;
+    std::vector<long> candidates;
+    for (long i = 0; i < vsize; i += 3) sources.push_back(i);
+    for (long i = 0; i < vsize; i++) candidates.push_back(i);
+    Network net(&graph, weights, sources);
+    DistanceMatrix<long> distances(net.csr, sources, candidates);
+
+    long facilities = 3;
+    long capacity = 4;
+    BranchAndBound::Flow flow(sources.size(), facilities, capacity);
+    long expected = BranchAndBound::infeasible();
+    std::vector<long> set(facilities);
+    for (set[0] = 0; set[0] < vsize; set[0]++) {
+        for (set[1] = set[0] + 1; set[1] < vsize; set[1]++) {
+            for (set[2] = set[1] + 1; set[2] < vsize; set[2]++) {
+                //the reused network of the search must agree with a network built for the set alone
+                long cost = assignment_cost(distances, set, capacity);
+                BOOST_REQUIRE_EQUAL(flow.solve(distances, set), cost);
+                expected = std::min(expected, cost);
+            }
+        }
+    }
+    BOOST_REQUIRE(expected != BranchAndBound::infeasible());
+    BranchAndBound sequential(distances, facilities, capacity);
+    BOOST_CHECK_EQUAL(sequential.solve(), expected);
+    BOOST_CHECK(sequential.evaluated_sets < vsize * (vsize - 1) * (vsize - 2) / 6);
+    BranchAndBound parallel(distances, facilities, capacity, 3);
+    BOOST_CHECK_EQUAL(parallel.solve(), expected);
+    //not enough capacity
+    BranchAndBound infeasible(distances, 2, 4);
+    BOOST_CHECK_EQUAL(infeasible.solve(), BranchAndBound::infeasible());
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+
+    //two components: sets within one of them can not serve the customers of the other
+    igraph_t split_graph;
+    std::vector<long> split_edges = {0,1,2,3};
+    std::vector<long> split_weights = {4,5};
+    std::vector<long> split_sources = {0,2};
+    std::vector<long> split_candidates = {0,1,2,3};
+    create_graph(&split_graph, 4, split_edges);
+    Network split(&split_graph, split_weights, split_sources);
+    DistanceMatrix<long> split_distances(split.csr, split_sources, split_candidates);
+    std::vector<long> one_component = {0,1};
+    BOOST_CHECK_EQUAL(assignment_cost(split_distances, one_component, 1), BranchAndBound::infeasible());
+    BranchAndBound::Flow split_flow(split_sources.size(), 2, 1);
+    BOOST_CHECK_EQUAL(split_flow.solve(split_distances, one_component), BranchAndBound::infeasible());
+    BranchAndBound split_search(split_distances, 2, 1);
+    BOOST_CHECK_EQUAL(split_search.solve(), 0);
+    BranchAndBound one_facility(split_distances, 1, 2);
+    BOOST_CHECK_EQUAL(one_facility.solve(), BranchAndBound::infeasible());
+    igraph_destroy(&split_graph);
+}
+
+BOOST_AUTO_TEST_CASE (testLagrangianBound) {
+    //bound lies between the uncapacitated bound and the optimum, also over truncated candidate lists
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 30;
+    generate_random_geometric_graph(vsize,0.3,&graph,weights,&x,&y);
+    std::vector<long> sources;
+    std::vector<long> candidates;
+    for (long i = 0; i < vsize; i += 3) sources.push_back(i);
+    for (long i = 0; i < vsize; i++) candidates.push_back(i);
+    Network net(&graph, weights, sources);
+    DistanceMatrix<long> distances(net.csr, sources, candidates);
+    long facilities = 3;
+    long capacity = 4;
+    BranchAndBound exact(distances, facilities, capacity);
+    long optimum = exact.solve();
+    double nearest = 0;
+    for (long i = 0; i < sources.size(); i++) {
+        nearest += *std::min_element(distances.distances.begin() + i * vsize, distances.distances.begin() + (i + 1) * vsize);
+    }
+
+    std::vector<long> counts = {vsize, 5};
+    for (long c = 0; c < counts.size(); c++) {
+        ExploringEdgeGenerator<long,long> generator(net);
+        LagrangianBound bound(&generator, std::vector<long>(vsize, capacity), facilities, counts[c]);
+        double result = bound.run(optimum);
+        BOOST_CHECK(result >= nearest - 1e-6);
+        BOOST_CHECK(result <= optimum + 1e-6);
+        BOOST_CHECK(bound.iterations > 0);
+    }
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testExplorationStateReset) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,2,3,3,4,4,5};
+    std::vector<long> weights = {1,1,1,1,1};
+    std::vector<long> sources = {0,5};
+    create_graph(&graph, 6, edges);
+    Network net(&graph, weights, sources);
+    ExploringEdgeGenerator<long,long> generator(net);
+
+    std::vector<long> first_run;
+    for (long i = 0; i < 3; i++) first_run.push_back(generator.getEdge(0).target_node);
+    //only settled nodes and their neighbors are touched
+    BOOST_CHECK_EQUAL(generator.states[0].touched(), 4);
+    BOOST_CHECK_EQUAL(generator.states[1].touched(), 1);
+
+    generator.reset();
+    BOOST_CHECK_EQUAL(generator.states[0].touched(), 1);
+    for (long i = 0; i < 3; i++) BOOST_CHECK_EQUAL(generator.getEdge(0).target_node, first_run[i]);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testSharedExplorationStreams) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,2,3,3,4,4,5};
+    std::vector<long> weights = {1,2,3,4,5};
+    std::vector<long> sources = {2,5,2,2};
+    create_graph(&graph, 6, edges);
+    Network net(&graph, weights, sources);
+    ExploringEdgeGenerator<long,long> generator(net);
+    //customers at node 2 are served by one dijkstra
+    BOOST_CHECK_EQUAL(generator.states.size(), 2);
+
+    std::vector<long> first_customer;
+    while (!generator.isComplete(0)) first_customer.push_back(generator.getEdge(0).weight);
+    BOOST_CHECK_EQUAL(first_customer.size(), 6);
+    BOOST_CHECK(generator.isComplete(0));
+    BOOST_CHECK(!generator.isComplete(2));
+    for (long i = 0; i < first_customer.size(); i++) {
+        BOOST_CHECK_EQUAL(generator.getEdge(2).weight, first_customer[i]);
+        newEdge e = generator.getEdge(3);
+        BOOST_CHECK_EQUAL(e.weight, first_customer[i]);
+        BOOST_CHECK_EQUAL(e.source_node, 3);
+    }
+    BOOST_CHECK(generator.isComplete(2));
+    BOOST_CHECK(!generator.getEdge(3).exists);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testResidualGraphFlip) {
+    ResidualGraph<long,long> g;
+    g.reset(4);
+    long h1 = g.push_front(0, 2, 5);
+    long h2 = g.push_front(0, 3, 7);
+    g.push_front(1, 3, 4);
+    BOOST_CHECK_EQUAL(g[0].size(), 2);
+    BOOST_CHECK_EQUAL(g[0].front().first, 3); //the last added edge goes first
+
+    g.flip(h1);
+    BOOST_CHECK_EQUAL(g[0].size(), 1);
+    BOOST_CHECK_EQUAL(g[2].front().first, 0);
+    BOOST_CHECK_EQUAL(g[2].front().second, -5);
+
+    //removed records are reused
+    g.erase(h2);
+    BOOST_CHECK(g[0].empty());
+    BOOST_CHECK_EQUAL(g.push_front(1, 0, 1), h2);
+    long weight_sum = 0;
+    for (auto e : g[1]) weight_sum += e.second;
+    BOOST_CHECK_EQUAL(weight_sum, 5);
+}
+
+BOOST_AUTO_TEST_CASE (testSetCover) {
+    //customers 0..3, facilities are nodes 4..6
+    ResidualGraph<long,long> g;
+    g.reset(7);
+    g.push_front(4, 0, -1);
+    g.push_front(4, 1, -1);
+    g.push_front(4, 2, -1);
+    g.push_front(5, 2, -1);
+    g.push_front(5, 3, -1);
+    g.push_front(6, 3, -1);
+    SetCover<long,long> set_cover;
+    BOOST_CHECK_EQUAL(set_cover.update(g, 4, 4, 3), 3);
+    std::vector<long> result;
+    BOOST_CHECK(set_cover.run(3, result));
+    BOOST_CHECK_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(result[0], 0);
+    BOOST_CHECK_EQUAL(set_cover.total_covered, 4);
+    BOOST_CHECK_EQUAL(set_cover.max_coverage, 3);
+
+    //only changed facilities are copied again
+    BOOST_CHECK_EQUAL(set_cover.update(g, 4, 4, 3), 0);
+    long handle = g.push_front(6, 1, -1);
+    g.erase(handle);
+    g.push_front(6, 0, -1);
+    BOOST_CHECK_EQUAL(set_cover.update(g, 4, 4, 3), 1);
+    result.clear();
+    BOOST_CHECK(!set_cover.run(0, result)); //the second facility exceeds the limit
+    BOOST_CHECK_EQUAL(result.size(), 1);
+
+    //a recounted facility waits behind less recently selected ones of its new coverage
+    ResidualGraph<long,long> h;
+    h.reset(8);
+    h.push_front(5, 0, -1);
+    h.push_front(5, 1, -1);
+    h.push_front(5, 2, -1);
+    h.push_front(6, 4, -1);
+    h.push_front(7, 2, -1);
+    h.push_front(7, 3, -1);
+    SetCover<long,long> recounted;
+    recounted.update(h, 5, 5, 3);
+    result.clear();
+    BOOST_CHECK(recounted.run(3, result));
+    BOOST_CHECK(result == std::vector<long>({0, 1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE (testBitsetSetCover) {
+    std::vector<uint64_t> a(9, ~(uint64_t) 0), b(9, 0);
+    b[8] = 0xff;
+    BOOST_CHECK_EQUAL(bitset_count_andnot(a.data(), b.data(), 9), 9 * 64 - 8);
+    bitset_or(b.data(), a.data(), 9);
+    BOOST_CHECK_EQUAL(bitset_count_andnot(a.data(), b.data(), 9), 0);
+
+    //the same cover with member arrays and with bitsets
+    ResidualGraph<long,long> g;
+    long customers = 200, facilities = 30;
+    g.reset(customers + facilities);
+    for (long c = 0; c < customers; c++) {
+        g.push_front(customers + c % facilities, c, -1);
+        g.push_front(customers + (c * 7 + 1) % facilities, c, -1);
+    }
+    SetCover<long,long> sparse, dense;
+    sparse.bitset_min_density = 2;
+    dense.bitset_min_density = 0;
+    sparse.update(g, customers, customers, facilities);
+    dense.update(g, customers, customers, facilities);
+    BOOST_CHECK(!sparse.use_bitsets);
+    BOOST_CHECK(dense.use_bitsets);
+    std::vector<long> sparse_result, dense_result;
+    BOOST_CHECK(sparse.run(facilities, sparse_result));
+    BOOST_CHECK(dense.run(facilities, dense_result));
+    BOOST_CHECK(sparse_result == dense_result);
+    BOOST_CHECK(sparse.covered == dense.covered);
+
+    //after a reset the same number of changes per facility gives the same versions with other members
+    g.reset(customers + facilities);
+    for (long c = 0; c < customers; c++) {
+        g.push_front(customers + c % facilities, (c + 1) % customers, -1);
+        g.push_front(customers + (c * 7 + 1) % facilities, (c + 1) % customers, -1);
+    }
+    SetCover<long,long> fresh;
+    fresh.bitset_min_density = 0;
+    fresh.update(g, customers, customers, facilities);
+    dense.update(g, customers, customers, facilities);
+    std::vector<long> fresh_result;
+    dense_result.clear();
+    BOOST_CHECK(fresh.run(facilities, fresh_result));
+    BOOST_CHECK(dense.run(facilities, dense_result));
+    BOOST_CHECK(fresh.rows == dense.rows);
+    BOOST_CHECK(fresh.covered == dense.covered);
+}
+
+BOOST_AUTO_TEST_CASE (testHilbertOrder) {
+    //corners of the bounding box are the first and the last cells of the curve
+    std::vector<std::pair<double,double>> points = {{0.5, 0.5}, {2, 0}, {0, 0}, {2, 2}, {0, 2}, {0, 0}};
+    std::vector<uint64_t> keys = HilbertOrder::keys(points);
+    BOOST_CHECK_EQUAL(keys[2], 0);
+    BOOST_CHECK_EQUAL(keys[1] == ~(uint64_t) 0 || keys[4] == ~(uint64_t) 0, true);
+    std::vector<long> items = {0, 1, 2, 3, 4, 5};
+    HilbertOrder::sort(items, keys);
+    for (long i = 1; i < items.size(); i++) {
+        BOOST_CHECK(keys[i-1] <= keys[i]);
+    }
+    //equal keys keep their order
+    BOOST_CHECK_EQUAL(items[0], 2);
+    BOOST_CHECK_EQUAL(items[1], 5);
+    BOOST_CHECK_EQUAL(items[2], 0);
+}
+
+BOOST_AUTO_TEST_CASE (testSpatialIndex) {
+    //nearest remaining point agrees with a linear scan, on a grid with many equal distances
+    std::vector<std::pair<double,double>> coords;
+    for (long i = 0; i < 400; i++) {
+        coords.push_back(std::make_pair((double) ((i * 7) % 20), (double) ((i * 13) % 17)));
+    }
+    std::vector<long> ids;
+    for (long i = 0; i < coords.size(); i += 3) {
+        ids.push_back(i);
+    }
+    SpatialIndex index(coords, ids);
+    std::vector<bool> removed(ids.size(), false);
+    for (long q = 0; q < ids.size(); q++) {
+        std::pair<double,double> query((q * 37 % 230) / 10.0, (q * 53 % 190) / 10.0);
+        long expected = -1;
+        double expected_dist = INFINITY;
+        for (long i = 0; i < ids.size(); i++) {
+            double dist = sqrt(pow(query.first - coords[ids[i]].first, 2) + pow(query.second - coords[ids[i]].second, 2));
+            if (!removed[i] && dist < expected_dist) {
+                expected = i;
+                expected_dist = dist;
+            }
+        }
+        BOOST_CHECK_EQUAL(index.nearest(query), expected);
+        index.remove(expected);
+        removed[expected] = true;
+    }
+    BOOST_CHECK_EQUAL(index.size(), 0);
+    BOOST_CHECK_EQUAL(index.nearest(std::make_pair(0.0, 0.0)), -1);
+}
+
+template<class Heap>
+std::vector<long> heapOrder(Heap& heap) {
+    heap.enqueue(0, 10);
+    heap.enqueue(1, 20);
+    heap.enqueue(2, 5);
+    heap.enqueue(3, 40);
+    heap.updateorenqueue(1, 7); //decrease-key
+    heap.updateorenqueue(4, 30);
+    std::vector<long> order;
+    long idx, val;
+    while (heap.size() > 0) {
+        heap.dequeue(idx, val);
+        BOOST_CHECK(!heap.isExisted(idx));
+        order.push_back(idx);
+    }
+    return order;
+}
+
+BOOST_AUTO_TEST_CASE (testHeapPolicies) {
+    fHeap<long,long> binary;
+    DaryHeap<long,long,4> dary;
+    RadixHeap<long,long> radix;
+    std::vector<long> expected({2,1,0,4,3});
+    std::vector<long> binary_order = heapOrder(binary);
+    std::vector<long> dary_order = heapOrder(dary);
+    std::vector<long> radix_order = heapOrder(radix);
+    BOOST_CHECK_EQUAL_COLLECTIONS(binary_order.begin(), binary_order.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(dary_order.begin(), dary_order.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(radix_order.begin(), radix_order.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE (testCSRAdjacency) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,3,4,2,0};
+    std::vector<long> weights = {5,6,7,8};
+    std::vector<long> sources = {0};
+    create_graph(&graph, 6, edges);
+    Network net(&graph, weights, sources);
+
+    BOOST_CHECK_EQUAL(net.graph_size(), 6);
+    BOOST_CHECK_EQUAL(net.csr.edge_count(), 4);
+    BOOST_CHECK_EQUAL(net.csr.degree(0), 2);
+    BOOST_CHECK_EQUAL(net.csr.degree(5), 0);
+    //neighbors are sorted by id and carry weights of their edges
+    const CSRGraph::Arc* arc = net.csr.begin(2);
+    BOOST_CHECK_EQUAL(arc[0].target, 0);
+    BOOST_CHECK_EQUAL(arc[0].weight, 8);
+    BOOST_CHECK_EQUAL(arc[1].target, 1);
+    BOOST_CHECK_EQUAL(arc[1].weight, 6);
+
+    BOOST_CHECK_EQUAL(net.components(), 3);
+    BOOST_CHECK_EQUAL(net.component_membership[2], net.component_membership[0]);
+    BOOST_CHECK_EQUAL(net.component_membership[4], 1);
+    BOOST_CHECK_EQUAL(net.component_membership[5], 2);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testGraphSimplifier) {
+    //every edge of a geometric graph becomes a chain of three, distances between kept nodes are the same
+    igraph_t geometric;
+    std::vector<long> geometric_weights;
+    igraph_vector_t x, y;
+    long vsize = 30;
+    generate_random_geometric_graph(vsize,0.3,&geometric,geometric_weights,&x,&y);
+    std::vector<long> edges;
+    std::vector<long> weights;
+    long node_count = vsize;
+    for (long i = 0; i < igraph_ecount(&geometric); i++) {
+        igraph_integer_t from, to;
+        igraph_edge(&geometric, i, &from, &to);
+        long w = geometric_weights[i];
+        std::vector<long> chain = {from, node_count, node_count + 1, to};
+        std::vector<long> parts = {w / 3, w / 3, w - 2 * (w / 3)};
+        for (long k = 0; k < 3; k++) {
+            edges.push_back(chain[k]);
+            edges.push_back(chain[k + 1]);
+            weights.push_back(parts[k]);
+        }
+        node_count += 2;
+    }
+    //a separate cycle without customers and facilities disappears
+    std::vector<long> cycle = {node_count, node_count + 1, node_count + 1, node_count + 2, node_count + 2, node_count};
+    edges.insert(edges.end(), cycle.begin(), cycle.end());
+    weights.insert(weights.end(), {1, 1, 1});
+    node_count += 3;
+
+    igraph_t graph;
+    create_graph(&graph, node_count, edges);
+    std::vector<long> sources;
+    std::vector<long> targets;
+    for (long i = 0; i < vsize; i += 4) sources.push_back(i);
+    for (long i = 1; i < vsize; i += 2) targets.push_back(i);
+    targets.push_back(vsize); //in the middle of the first chain
+    Network net(&graph, weights, sources);
+    net.set_target_indexes(targets, 2);
+
+    GraphSimplifier simplifier(net);
+    Network* simplified = simplifier.simplified;
+    BOOST_CHECK(simplified->graph_size() <= vsize + 1);
+    BOOST_CHECK_EQUAL(simplifier.node_ids[simplifier.new_id[vsize]], vsize);
+    BOOST_CHECK_EQUAL(simplifier.new_id[node_count - 1], -1);
+    for (long i = 0; i < sources.size(); i++) {
+        BOOST_CHECK_EQUAL(simplifier.node_ids[simplified->source_indexes[i]], sources[i]);
+    }
+    DistanceMatrix<long> original(net.csr, net.source_indexes, net.target_indexes);
+    DistanceMatrix<long> contracted(simplified->csr, simplified->source_indexes, simplified->target_indexes);
+    BOOST_CHECK(original.distances == contracted.distances);
+
+    Logger logger;
+    logger.add("facilities_indexes", std::to_string(simplifier.new_id[vsize]) + "," + std::to_string(simplifier.new_id[3]) + ",");
+    simplifier.restore_ids(&logger);
+    BOOST_CHECK_EQUAL(logger.str_dict["facilities_indexes"][0], std::to_string(vsize) + ",3,");
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&geometric);
+    igraph_destroy(&graph);
+}
+
+BOOST_AUTO_TEST_CASE (testBinaryNetworkRoundTrip) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,3,4,2,0};
+    std::vector<long> weights = {5,6,7,8};
+    std::vector<long> sources = {0,4};
+    create_graph(&graph, 6, edges);
+    Network net(&graph, weights, sources);
+    net.set_target_indexes({1,3}, {2,5});
+    std::string filename = "/tmp/fcla_test_roundtrip.ntwb";
+    net.save("", filename);
+
+    Network loaded(filename);
+    BOOST_CHECK_EQUAL(loaded.id, net.id);
+    BOOST_CHECK_EQUAL(loaded.graph_size(), 6);
+    BOOST_CHECK_EQUAL(loaded.csr.edge_count(), 4);
+    BOOST_CHECK(!loaded.csr.is_owner()); //adjacency is used from the mapped file
+    BOOST_CHECK_EQUAL(loaded.csr.begin(2)[0].weight, 8);
+    BOOST_CHECK_EQUAL(loaded.components(), 3);
+    BOOST_CHECK(loaded.source_indexes == sources);
+    BOOST_CHECK(loaded.weights == weights);
+    BOOST_CHECK_EQUAL(loaded.target_indexes.size(), 2);
+    BOOST_CHECK_EQUAL(loaded.target_capacities[1], 5);
+    BOOST_CHECK_EQUAL(igraph_ecount(loaded.get_graph()), 4);
+
+    //mapped adjacency must not lead outside of its arcs and nodes
+    NtwbHeader header;
+    int fd = open(filename.c_str(), O_RDWR);
+    BOOST_REQUIRE(pread(fd, &header, sizeof(header), 0) == sizeof(header));
+    int64_t offset, bad_offset = 2 * header.edge_count - 1;
+    pread(fd, &offset, sizeof(offset), header.csr_offsets_offset + 8);
+    pwrite(fd, &bad_offset, sizeof(bad_offset), header.csr_offsets_offset + 8); //offsets decrease after node 1
+    BOOST_CHECK_THROW(Network corrupt(filename), std::invalid_argument);
+    pwrite(fd, &offset, sizeof(offset), header.csr_offsets_offset + 8);
+    int64_t target, bad_target = header.node_count;
+    pread(fd, &target, sizeof(target), header.csr_arcs_offset);
+    pwrite(fd, &bad_target, sizeof(bad_target), header.csr_arcs_offset);
+    BOOST_CHECK_THROW(Network corrupt(filename), std::invalid_argument);
+    pwrite(fd, &target, sizeof(target), header.csr_arcs_offset);
+    close(fd);
+    Network restored(filename);
+    BOOST_CHECK_EQUAL(restored.csr.begin(2)[0].weight, 8);
+
+    //columns past the end of a truncated file are rejected
+    struct stat file_stat;
+    stat(filename.c_str(), &file_stat);
+    BOOST_CHECK_EQUAL(truncate(filename.c_str(), file_stat.st_size - 8), 0);
+    BOOST_CHECK_THROW(Network truncated(filename), std::invalid_argument);
+    BOOST_CHECK_EQUAL(truncate(filename.c_str(), sizeof(NtwbHeader) + 8), 0);
+    BOOST_CHECK_THROW(Network truncated(filename), std::invalid_argument);
+    igraph_destroy(&graph);
+    unlink(filename.c_str());
+
+    //multiple edges are not allowed, as in text files
+    igraph_t multigraph;
+    std::vector<long> multi_edges = {0,1,1,0};
+    std::vector<long> multi_weights = {1,2};
+    std::vector<long> multi_sources = {0};
+    create_graph(&multigraph, 2, multi_edges);
+    Network multinet(&multigraph, multi_weights, multi_sources);
+    BOOST_CHECK_THROW(multinet.save("", filename), std::invalid_argument);
+    igraph_destroy(&multigraph);
+    unlink(filename.c_str());
+}
+
 BOOST_AUTO_TEST_CASE (basicFacilityLocation) {
     igraph_t graph;
     igraph_empty(&graph, 3, false);
@@ -77,6 +739,37 @@ BOOST_AUTO_TEST_CASE (basicFacilityLocation) {
     igraph_destroy(&graph);
 }
 
+BOOST_AUTO_TEST_CASE (testTargetEdgeGeneratorReplay) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,2,3,3,4,1,5};
+    std::vector<long> weights = {2,1,3,1,4};
+    std::vector<long> sources = {0,4,5};
+    create_graph(&graph, 6, edges);
+    Network net(&graph, weights, sources);
+    Logger logger;
+    FacilityChooser fcla(net, 2, 2, &logger);
+    fcla.locateFacilities();
+
+    //edges to chosen facilities: memorized ones first, then resumed exploration, as if explored from scratch
+    TargetEdgeGenerator replaying(&fcla, fcla.result);
+    std::vector<long> chosen_node_ids = fcla.get_chosen_facility_node_ids();
+    TargetExploringEdgeGenerator<long,long> exploring(net, chosen_node_ids);
+    long replayed = 0;
+    for (long i = 0; i < sources.size(); i++) {
+        replayed += replaying.edgeQueue[i].size();
+        while (true) {
+            newEdge e1 = replaying.getEdge(i);
+            newEdge e2 = exploring.getEdge(i);
+            BOOST_CHECK_EQUAL(e1.exists, e2.exists);
+            if (!e1.exists || !e2.exists) break;
+            BOOST_CHECK_EQUAL(e1.target_node, e2.target_node);
+            BOOST_CHECK_EQUAL(e1.weight, e2.weight);
+        }
+    }
+    BOOST_CHECK(replayed > 0);
+    igraph_destroy(&graph);
+}
+
 BOOST_AUTO_TEST_CASE (testDuple) {
     igraph_t graph;
     std::vector<long> edges = {0,1,1,2,2,3,3,4};
@@ -171,6 +864,56 @@ BOOST_AUTO_TEST_CASE (test3TrippleGreedy) {
     igraph_destroy(&graph);
 }
 
+BOOST_AUTO_TEST_CASE (testIncrementalGreedyMatching) {
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,3,4,4,2,5,6,6,2};
+    std::vector<long> weights = {1,2,3,4,5,6};
+    std::vector<long> sources = {0,3,5};
+    create_graph(&graph, 7, edges);
+    Network net(&graph, weights, sources);
+    Logger logger;
+    FacilityChooser incremental(net, 2, 2, &logger);
+    FacilityChooser full(net, 2, 2, &logger);
+    full.incremental_greedy = false;
+    FacilityChooser* choosers[2] = {&incremental, &full};
+    std::vector<std::vector<int>> complete_sources(2, std::vector<int>(3, 0));
+    std::vector<std::set<std::pair<long,long>>> pairs(2); //(customer, facility)
+    std::vector<long> totals(2);
+    for (int k = 0; k < 2; k++) {
+        choosers[k]->greedyMatching = true;
+        choosers[k]->greedyMatchingOrder = 3;
+        choosers[k]->match();
+    }
+    for (int iteration = 0; iteration < 3; iteration++) {
+        for (int k = 0; k < 2; k++) {
+            choosers[k]->findSetCover();
+            choosers[k]->increaseCapacities(complete_sources[k]);
+            //every customer is matched to distinct facilities as many times as its demand
+            std::vector<long> matched(3, 0);
+            pairs[k].clear();
+            for (long i = 3; i < choosers[k]->graph_size - 1; i++) {
+                for (auto e : choosers[k]->edges[i]) {
+                    matched[e.first]++;
+                    pairs[k].insert(std::make_pair(e.first, i));
+                }
+            }
+            totals[k] = 0;
+            for (long i = 0; i < 3; i++) {
+                BOOST_CHECK_EQUAL(matched[i], -choosers[k]->full_node_excess[i]);
+                totals[k] += matched[i];
+            }
+            BOOST_CHECK_EQUAL(pairs[k].size(), totals[k]);
+        }
+        //incremental repair ends in the same matching as the greedy matching from scratch
+        BOOST_CHECK(pairs[0] == pairs[1]);
+    }
+    BOOST_CHECK(incremental.greedy_pending.empty());
+    for (long i = 0; i < 3; i++) {
+        BOOST_CHECK_EQUAL(incremental.full_node_excess[i], full.full_node_excess[i]);
+    }
+    igraph_destroy(&graph);
+}
+
 void compare_edges(std::pair<long, long>& e1, std::pair<long,long>& e2) {
     BOOST_CHECK_EQUAL(e1.first, e2.first);
     BOOST_CHECK_EQUAL(e1.second, e2.second);
@@ -254,4 +997,38 @@ BOOST_AUTO_TEST_CASE (lonelyCustomerInTwoComponentGraphExceptionExpected) {
 
     FacilityChooser fcla2(net, 2, 1, &logger);
     BOOST_CHECK_THROW(fcla2.locateFacilities(), NoMoreCapacitiesToIncrease);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE (testComponentFacilityChooser) {
+    //two components with customers and an isolated node
+    igraph_t graph;
+    std::vector<long> edges = {0,1,1,2,3,4,4,5};
+    std::vector<long> weights = {3,4,5,1};
+    std::vector<long> sources = {5,0,2};
+    create_graph(&graph, 7, edges);
+    Network net(&graph, weights, sources);
+    BOOST_CHECK_EQUAL(net.components(), 3);
+
+    std::vector<long> component_ids = {net.component_membership[5], net.component_membership[0]};
+    std::vector<std::vector<long>> node_ids;
+    std::vector<Network*> parts = net.extract_components(component_ids, node_ids);
+    BOOST_CHECK(node_ids[0] == std::vector<long>({3,4,5}));
+    BOOST_CHECK(parts[0]->source_indexes == std::vector<long>({2}));
+    BOOST_CHECK(parts[1]->source_indexes == std::vector<long>({0,2}));
+    BOOST_CHECK_EQUAL(parts[1]->weights.size(), 2);
+    for (long k = 0; k < parts.size(); k++) {
+        delete parts[k];
+    }
+
+    Logger logger;
+    ComponentFacilityChooser fcla(net, 3, 2, &logger);
+    fcla.threads = 2;
+    fcla.run();
+    BOOST_CHECK_EQUAL(fcla.facilities_per_component.size(), 2);
+    BOOST_CHECK_EQUAL(fcla.facilities_per_component[0] + fcla.facilities_per_component[1], 3);
+    BOOST_CHECK_EQUAL(fcla.result.size(), 3);
+    BOOST_CHECK(std::find(fcla.result.begin(), fcla.result.end(), 5) != fcla.result.end());
+    BOOST_CHECK_EQUAL(fcla.totalCost, 0); //customers of the larger component get a facility each
+    BOOST_CHECK_EQUAL(logger.float_dict["objective"][0], 0);
+    igraph_destroy(&graph);
+}
@@ -30,6 +30,66 @@ BOOST_AUTO_TEST_CASE (testLonelyComponents) {
     igraph_destroy(&graph);
 }
 
+BOOST_AUTO_TEST_CASE (testIncrementalNLR) {
+    //NLRs cut by placed facilities must be the same as NLRs calculated from scratch
+    igraph_t graph;
+    std::vector<long> weights;
+    igraph_vector_t x, y;
+    long vsize = 200;
+    generate_random_geometric_graph(vsize,0.15,&graph,weights,&x,&y);
+    std::vector<long> sources;
+    std::vector<long> facilities;
+    for (long i = 0; i < vsize; i += 3) sources.push_back(i);
+    for (long i = 1; i < vsize; i += 4) facilities.push_back(i);
+    Network net(&graph, weights, sources);
+    net.set_target_indexes(facilities, std::vector<long>(facilities.size(), 100));
+
+    Logger logger;
+    NLR solver(net, &logger, 100, 25);
+    solver.reset();
+    solver.calculateAllNLRs();
+    for (long i = 0; i < 10; i++) {
+        //the heap gives the first facility with the largest NLR
+        long expected = -1;
+        for (long f = 0; f < solver.facility_indexes.size(); f++) {
+            if (solver.isFacilityAvailable(f) && (expected == -1 || solver.nlr_size[f] > solver.nlr_size[expected])) {
+                expected = f;
+            }
+        }
+        solver.placeFacility();
+        BOOST_REQUIRE_EQUAL(solver.located_facility_indexes.back(), expected);
+        solver.updateNLRs();
+        std::vector<long> incremental = solver.nlr_size;
+        solver.calculateAllNLRs();
+        BOOST_REQUIRE(incremental == solver.nlr_size);
+        for (long f = 0; f < solver.nlrs.size(); f++) {
+            BOOST_REQUIRE_EQUAL(solver.nlrs[f].size(), solver.nlr_size[f]);
+        }
+    }
+
+    //as in placeAllFacilities: only cut NLRs between placements, the heap keeps outdated sizes until they are on top
+    NLR lazy(net, &logger, 100, 25);
+    lazy.reset();
+    lazy.calculateAllNLRs();
+    for (long i = 0; i < 10; i++) {
+        if (i > 0) {
+            lazy.updateNLRs();
+        }
+        long expected = -1;
+        for (long f = 0; f < lazy.facility_indexes.size(); f++) {
+            if (lazy.isFacilityAvailable(f) && (expected == -1 || lazy.nlr_size[f] > lazy.nlr_size[expected])) {
+                expected = f;
+            }
+        }
+        lazy.placeFacility();
+        BOOST_REQUIRE_EQUAL(lazy.located_facility_indexes.back(), expected);
+    }
+
+    igraph_vector_destroy(&x);
+    igraph_vector_destroy(&y);
+    igraph_destroy(&graph);
+}
+
 //
 //BOOST_AUTO_TEST_CASE (testLonelyComponents) {
 //    igraph_t graph;